@@ -59,9 +59,11 @@ struct BufferedAudioBus {
  */
 struct BufferedOutputBus: BufferedAudioBus {
     void prepareOutputBufferList(AudioBufferList* outBufferList, AVAudioFrameCount frameCount, bool zeroFill) {
-        UInt32 byteSize = frameCount * sizeof(float);
         for (UInt32 i = 0; i < outBufferList->mNumberBuffers; ++i) {
-            outBufferList->mBuffers[i].mNumberChannels = originalAudioBufferList->mBuffers[i].mNumberChannels;
+            // An interleaved buffer holds all of the channels.
+            UInt32 channelCount = originalAudioBufferList->mBuffers[i].mNumberChannels;
+            UInt32 byteSize = frameCount * channelCount * sizeof(float);
+            outBufferList->mBuffers[i].mNumberChannels = channelCount;
             outBufferList->mBuffers[i].mDataByteSize = byteSize;
             if (outBufferList->mBuffers[i].mData == nullptr) {
                 outBufferList->mBuffers[i].mData = originalAudioBufferList->mBuffers[i].mData;
@@ -121,11 +123,13 @@ struct BufferedInputBus : BufferedAudioBus {
      render cycle this function needs to be called to reset them.
      */
     void prepareInputBufferList(UInt32 frameCount) {
-        UInt32 byteSize = std::min(frameCount, maxFrames) * sizeof(float);
         mutableAudioBufferList->mNumberBuffers = originalAudioBufferList->mNumberBuffers;
 
         for (UInt32 i = 0; i < originalAudioBufferList->mNumberBuffers; ++i) {
-            mutableAudioBufferList->mBuffers[i].mNumberChannels = originalAudioBufferList->mBuffers[i].mNumberChannels;
+            // An interleaved buffer holds all of the channels.
+            UInt32 channelCount = originalAudioBufferList->mBuffers[i].mNumberChannels;
+            UInt32 byteSize = std::min(frameCount, maxFrames) * channelCount * sizeof(float);
+            mutableAudioBufferList->mBuffers[i].mNumberChannels = channelCount;
             mutableAudioBufferList->mBuffers[i].mData = originalAudioBufferList->mBuffers[i].mData;
             mutableAudioBufferList->mBuffers[i].mDataByteSize = byteSize;
         }
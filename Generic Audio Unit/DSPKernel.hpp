@@ -20,8 +20,30 @@ public:
     virtual void handleMIDIEvent(AUMIDIEvent const& midiEvent) {}
     virtual void handleParameterEvent(AUParameterEvent const& parameterEvent) {}
 
+    // Override to return false for events that need not split rendering,
+    // i.e. that need not be handled between calls to `process`. Such
+    // events are passed to `handleUnsplitEvent` before the call to
+    // `process` for the segment containing them, along with their frame
+    // offsets in the buffer, and the subclass applies them at those
+    // offsets itself (or not, if sample accuracy does not matter).
+    virtual bool splitsRendering(AURenderEvent const& event) { return true; }
+    virtual void handleUnsplitEvent(AURenderEvent const& event, AUAudioFrameCount bufferOffset) {
+        handleOneEvent(&event);
+    }
+
     void processWithEvents(AudioTimeStamp const* timestamp, AUAudioFrameCount frameCount, AURenderEvent const* events, AUMIDIOutputEventBlock midiOut);
 
+    // The smallest number of frames `processWithEvents` passes to
+    // `process`, except at the end of a buffer. Events that split
+    // rendering are performed late if necessary to honor this.
+    AUAudioFrameCount minimumSegmentSize() const {
+        return minSegmentSize;
+    }
+
+    void setMinimumSegmentSize(AUAudioFrameCount frames) {
+        minSegmentSize = std::max(frames, AUAudioFrameCount(1));
+    }
+
     AUAudioFrameCount maximumFramesToRender() const {
         return maxFramesToRender;
     }
@@ -30,11 +52,14 @@ public:
         maxFramesToRender = maxFrames;
     }
 
-private:
+protected:
     void handleOneEvent(AURenderEvent const* event);
-    void performAllSimultaneousEvents(AUEventSampleTime now, AURenderEvent const*& event, AUMIDIOutputEventBlock midiOut);
+
+private:
+    void performEvent(AUEventSampleTime now, AURenderEvent const* event, AUAudioFrameCount bufferOffset, AUMIDIOutputEventBlock midiOut);
 
     AUAudioFrameCount maxFramesToRender = 4096;
+    AUAudioFrameCount minSegmentSize = 1;
 };
 
 #endif /* DSPKernel_h */
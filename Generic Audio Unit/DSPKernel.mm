@@ -9,7 +9,8 @@
 
 void DSPKernel::handleOneEvent(AURenderEvent const *event) {
     switch (event->head.eventType) {
-        case AURenderEventParameter: {
+        case AURenderEventParameter:
+        case AURenderEventParameterRamp: {
             handleParameterEvent(event->parameter);
             break;
         }
@@ -23,57 +24,69 @@ void DSPKernel::handleOneEvent(AURenderEvent const *event) {
     }
 }
 
-void DSPKernel::performAllSimultaneousEvents(AUEventSampleTime now, AURenderEvent const *&event, AUMIDIOutputEventBlock midiOut) {
-    do {
-        handleOneEvent(event);
+void DSPKernel::performEvent(AUEventSampleTime now, AURenderEvent const *event, AUAudioFrameCount bufferOffset, AUMIDIOutputEventBlock midiOut) {
+    if (!splitsRendering(*event)) {
+        handleUnsplitEvent(*event, bufferOffset);
+        return;
+    }
 
-        if (event->head.eventType == AURenderEventMIDI && midiOut)
-        {
-            midiOut(now, 0, event->MIDI.length, event->MIDI.data);
-        }
-        
-        // Go to next event.
-        event = event->head.next;
+    handleOneEvent(event);
 
-        // While event is not null and is simultaneous (or late).
-    } while (event && event->head.eventSampleTime <= now);
+    if (event->head.eventType == AURenderEventMIDI && midiOut)
+    {
+        midiOut(now, 0, event->MIDI.length, event->MIDI.data);
+    }
 }
 
 /**
  This function handles the event list processing and rendering loop for you.
  Call it inside your internalRenderBlock.
+
+ Rendering is split only at events for which `splitsRendering` returns
+ true, and never into segments shorter than `minimumSegmentSize` frames,
+ except at the end of the buffer. Other events are passed to
+ `handleUnsplitEvent` with their offsets before the segments containing
+ them are processed.
  */
 void DSPKernel::processWithEvents(AudioTimeStamp const *timestamp, AUAudioFrameCount frameCount, AURenderEvent const *events, AUMIDIOutputEventBlock midiOut) {
 
-    AUEventSampleTime now = AUEventSampleTime(timestamp->mSampleTime);
+    AUEventSampleTime const start = AUEventSampleTime(timestamp->mSampleTime);
+    AUEventSampleTime now = start;
     AUAudioFrameCount framesRemaining = frameCount;
     AURenderEvent const *event = events;
 
     while (framesRemaining > 0) {
-        // If there are no more events, we can process the entire remaining segment and exit.
-        if (event == nullptr) {
-            AUAudioFrameCount const bufferOffset = frameCount - framesRemaining;
-            process(framesRemaining, bufferOffset);
-            return;
-        }
+        AUAudioFrameCount const bufferOffset = frameCount - framesRemaining;
 
-        // **** start late events late.
-        auto timeZero = AUEventSampleTime(0);
-        auto headEventTime = event->head.eventSampleTime;
-        AUAudioFrameCount const framesThisSegment = AUAudioFrameCount(std::max(timeZero, headEventTime - now));
-
-        // Compute everything before the next event.
-        if (framesThisSegment > 0) {
-            AUAudioFrameCount const bufferOffset = frameCount - framesRemaining;
-            process(framesThisSegment, bufferOffset);
+        // Perform events that are due, starting late events late.
+        while (event && event->head.eventSampleTime <= now) {
+            performEvent(now, event, bufferOffset, midiOut);
+            event = event->head.next;
+        }
 
-            // Advance frames.
-            framesRemaining -= framesThisSegment;
+        // End the segment at the next event that splits rendering, but
+        // not before the minimum segment size.
+        AUEventSampleTime end = now + framesRemaining;
+        for (AURenderEvent const *e = event; e && e->head.eventSampleTime < end; e = e->head.next) {
+            if (splitsRendering(*e)) {
+                auto const minEnd = now + std::min(minSegmentSize, framesRemaining);
+                end = std::max(e->head.eventSampleTime, minEnd);
+                break;
+            }
+        }
 
-            // Advance time.
-            now += AUEventSampleTime(framesThisSegment);
+        // Hand over events that do not split rendering up to the next
+        // event that does.
+        while (event && event->head.eventSampleTime < end && !splitsRendering(*event)) {
+            auto const eventOffset = AUAudioFrameCount(event->head.eventSampleTime - start);
+            handleUnsplitEvent(*event, eventOffset);
+            event = event->head.next;
         }
 
-        performAllSimultaneousEvents(now, event, midiOut);
+        AUAudioFrameCount const framesThisSegment = AUAudioFrameCount(end - now);
+        process(framesThisSegment, bufferOffset);
+
+        framesRemaining -= framesThisSegment;
+        now = end;
     }
 }
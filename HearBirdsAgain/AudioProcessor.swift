@@ -120,7 +120,13 @@ class AudioProcessor: ObservableObject {
     // pitch shifting audio unit.
     
     
-    public static let requiredSampleRate: Double = 48000.0
+    // The song finder processes audio at the input sample rate, so
+    // that the system need not convert rates. We prefer 48 kHz, the
+    // native rate of built-in iPhone audio, but accept other rates
+    // down to 44.1 kHz, including the higher rates of ultrasonic
+    // microphones.
+    public static let preferredSampleRate: Double = 48000.0
+    public static let minimumSampleRate: Double = 44100.0
     
     static let defaultState = AudioProcessorState()
     
@@ -137,7 +143,6 @@ class AudioProcessor: ObservableObject {
             }
             
             songFinderAudioUnit.parameters.cutoff.value = AUValue(cutoff)
-            restartIfRunning()
             
         }
         
@@ -146,21 +151,18 @@ class AudioProcessor: ObservableObject {
     @Published var pitchShift = defaultState.pitchShift {
         didSet {
             songFinderAudioUnit.parameters.pitchShift.value = AUValue(pitchShift)
-            restartIfRunning()
         }
     }
     
     @Published var windowType = defaultState.windowType {
         didSet {
             songFinderAudioUnit.parameters.windowType.value = AUValue(windowType.rawValue)
-            restartIfRunning()
         }
     }
     
     @Published var windowSize = defaultState.windowSize {
         didSet {
             songFinderAudioUnit.parameters.windowSize.value = AUValue(windowSize)
-            restartIfRunning()
         }
     }
     
@@ -308,9 +310,9 @@ class AudioProcessor: ObservableObject {
                 return
             }
             
-            // Make sure sample rate is as required.
-            if session.sampleRate != AudioProcessor.requiredSampleRate {
-                errors.handleNonfatalError(message: "Cannot start audio processing. Input sample rate of \(session.sampleRate) Hz differs from required rate of \(AudioProcessor.requiredSampleRate) Hz. Please try a different input device.")
+            // Make sure sample rate is supported.
+            if session.sampleRate < AudioProcessor.minimumSampleRate {
+                errors.handleNonfatalError(message: "Cannot start audio processing. Input sample rate of \(session.sampleRate) Hz is less than minimum rate of \(AudioProcessor.minimumSampleRate) Hz. Please try a different input device.")
                 return
             }
             
@@ -332,6 +334,7 @@ class AudioProcessor: ObservableObject {
                 if !self.isOutputMono {
                     self.outputLevels[1] = parameters.outputLevel1.value
                 }
+                self.logDiagnosticMessages()
             }
             
             running = true
@@ -341,6 +344,15 @@ class AudioProcessor: ObservableObject {
     }
     
     
+    // Logs diagnostic messages from the SongFinder audio unit's render
+    // thread, which cannot log them itself without risking glitches.
+    private func logDiagnosticMessages() {
+        for message in songFinderAudioUnit.drainDiagnosticMessages() {
+            console.log(message)
+        }
+    }
+    
+    
     private func configureSongFinderAudioUnit() {
         
         songFinderAudioUnit.parameters.setValues(
@@ -351,6 +363,56 @@ class AudioProcessor: ObservableObject {
             gain: appGain,
             balance: balance)
         
+        updateProcessingBlockSize()
+        updateProcessingQuality()
+        updateActivityGate()
+        configureAsyncRendering()
+        
+    }
+    
+    
+    // Applies the processing block size setting, which trades latency
+    // for CPU usage. The audio unit applies the new size without
+    // restarting.
+    func updateProcessingBlockSize() {
+        songFinderAudioUnit.processingBlockSize = AUAudioFrameCount(HbaApp.processingBlockSize)
+    }
+    
+    
+    // Applies the processing quality setting, which trades filter
+    // quality for CPU usage. Like other processing parameter changes,
+    // this takes effect without restarting.
+    func updateProcessingQuality() {
+        songFinderAudioUnit.parameters.quality.value = AUValue(HbaApp.processingQuality)
+    }
+    
+    
+    // Applies the idle when quiet setting. The audio unit applies it
+    // without restarting.
+    func updateActivityGate() {
+        songFinderAudioUnit.activityGate = HbaApp.activityGate
+    }
+    
+    
+    // Applies the background processing setting. The audio unit
+    // applies it when its render resources are next allocated, so we
+    // restart if it changed while running.
+    func updateAsyncRendering() {
+        if HbaApp.asyncRendering != songFinderAudioUnit.asyncRendering {
+            configureAsyncRendering()
+            restartIfRunning()
+        }
+    }
+    
+    
+    // Configures asynchronous rendering, with an added latency of two
+    // I/O buffers, which leaves the worker thread a full buffer period
+    // of slack.
+    private func configureAsyncRendering() {
+        let session = AVAudioSession.sharedInstance()
+        let bufferSize = (session.ioBufferDuration * session.sampleRate).rounded(.up)
+        songFinderAudioUnit.asyncRendering = HbaApp.asyncRendering
+        songFinderAudioUnit.asyncRenderingLatency = AUAudioFrameCount(2 * bufferSize)
     }
     
     
@@ -367,8 +429,15 @@ class AudioProcessor: ObservableObject {
         
         engine.attach(songFinderEffect)
         
+        // The song finder effect outputs audio at its input sample
+        // rate, and the output node converts it to the output rate if
+        // that differs.
+        let effectOutputFormat = AVAudioFormat(
+            standardFormatWithSampleRate: inputFormat.sampleRate,
+            channels: outputFormat.channelCount)
+        
         engine.connect(input, to: songFinderEffect, format: inputFormat)
-        engine.connect(songFinderEffect, to: output, format: outputFormat)
+        engine.connect(songFinderEffect, to: output, format: effectOutputFormat)
 
     }
     
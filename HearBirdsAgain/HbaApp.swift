@@ -42,6 +42,10 @@ class HbaApp: App {
     @AppStorage("donateButtonVisible") static var donateButtonVisible = true
     @AppStorage("zeroHzCutoffVisible") static var zeroHzCutoffVisible = false
     @AppStorage("consoleTabVisible") static var consoleTabVisible = false
+    @AppStorage("processingBlockSize") static var processingBlockSize = 0
+    @AppStorage("processingQuality") static var processingQuality = 0
+    @AppStorage("activityGate") static var activityGate = false
+    @AppStorage("asyncRendering") static var asyncRendering = false
     
     
     var body: some Scene {
@@ -265,6 +269,11 @@ class HbaApp: App {
             audioProcessor.cutoff = AudioProcessor.defaultState.cutoff
         }
         
+        audioProcessor.updateProcessingBlockSize()
+        audioProcessor.updateProcessingQuality()
+        audioProcessor.updateActivityGate()
+        audioProcessor.updateAsyncRendering()
+        
     }
     
     
@@ -316,7 +325,7 @@ private func configureAudioSession() throws {
     }
     
     // Set preferred sample rate.
-    let sampleRate = AudioProcessor.requiredSampleRate
+    let sampleRate = AudioProcessor.preferredSampleRate
     do {
         try session.setPreferredSampleRate(sampleRate)
     } catch {
@@ -0,0 +1,297 @@
+#ifndef ACTIVITY_GATE
+#define ACTIVITY_GATE
+
+
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include "GainRamp.hpp"
+
+
+using std::size_t;
+
+
+// Settings of an `ActivityGate`.
+struct ActivityGateSettings {
+
+    bool enabled = false;
+
+    // Band power in dBFS above which the gate opens, where full scale
+    // is a power of one.
+    float open_threshold = -60;
+
+    // Amount in dB by which the band power must fall below the open
+    // threshold for the gate to start closing.
+    float hysteresis = 6;
+
+    // Seconds for which the band power must stay below the close
+    // threshold before the gate closes.
+    double hold_duration = .5;
+
+    // Duration in seconds of the fades with which the gate opens and
+    // closes.
+    double fade_duration = .01;
+
+};
+
+
+// Detects when a processor's input has no energy in the band that it
+// processes, so that the processor can idle.
+//
+// The gate measures the power of each block of input above the
+// processor's cutoff with a fourth-order Butterworth highpass filter
+// (or of the whole input if the cutoff is zero), which costs a few
+// operations per sample. The gate opens as soon as the power of a
+// block exceeds the open threshold, and closes once the power has
+// stayed below the lower close threshold for the hold duration. The
+// gate fades the processor output in when it opens and out when it
+// closes.
+//
+// The gate adds no latency. When it opens, the processor has not yet
+// output anything computed from the block that opened it, since that
+// takes the processor latency, which exceeds the fade duration. So
+// the onset of the sound that opens the gate is output at full gain.
+
+
+class ActivityGate {
+
+
+public:
+
+
+    ActivityGate(
+        const ActivityGateSettings &settings, unsigned cutoff,
+        double sample_rate) :
+
+        _settings(settings),
+        _filtered(cutoff != 0),
+        _open_power(_get_power(settings.open_threshold)),
+        _close_power(
+            _get_power(settings.open_threshold - settings.hysteresis)),
+        _hold_size(
+            static_cast<size_t>(std::round(settings.hold_duration * sample_rate))),
+        _fade_size(
+            static_cast<size_t>(std::round(settings.fade_duration * sample_rate))),
+        _quiet_count(0),
+        _open(true),
+        _fade(1)
+
+    {
+        if (_filtered) {
+            _sections[0] = _get_highpass_section(cutoff, sample_rate, 0.54119610);
+            _sections[1] = _get_highpass_section(cutoff, sample_rate, 1.30656296);
+        }
+    }
+
+
+    bool enabled() const {
+        return _settings.enabled;
+    }
+
+
+    // Returns `true` if the processor output is currently silent, so
+    // that the processor need not compute it.
+    bool idle() const {
+        return !_fade.ramping() && _fade.gain() == 0;
+    }
+
+
+    // Measures `count` input samples, read `stride` floats apart, and
+    // updates the state of the gate accordingly. Returns `true` if the
+    // processor must compute output for the samples, or `false` if the
+    // output is silent.
+    bool update(const float *input, size_t count, size_t stride = 1) {
+
+        const float power = _measure(input, count, stride);
+
+        if (power > _open_power) {
+
+            _quiet_count = 0;
+
+            if (!_open) {
+                _open = true;
+                _fade.set_target(1, _fade_size, GainRampShape::Linear);
+            }
+
+        } else if (_open && power < _close_power) {
+
+            _quiet_count += count;
+
+            if (_quiet_count >= _hold_size) {
+                _open = false;
+                _fade.set_target(0, _fade_size, GainRampShape::Linear);
+            }
+
+        } else {
+
+            _quiet_count = 0;
+
+        }
+
+        return !idle();
+
+    }
+
+
+    // The state of a gate, apart from its settings.
+    struct State {
+        float z[2][2];
+        size_t quiet_count;
+        bool open;
+        GainRamp fade;
+    };
+
+
+    State state() const {
+        State state;
+        for (int i = 0; i != 2; ++i) {
+            state.z[i][0] = _sections[i].z1;
+            state.z[i][1] = _sections[i].z2;
+        }
+        state.quiet_count = _quiet_count;
+        state.open = _open;
+        state.fade = _fade;
+        return state;
+    }
+
+
+    void set_state(const State &state) {
+        for (int i = 0; i != 2; ++i) {
+            _sections[i].z1 = state.z[i][0];
+            _sections[i].z2 = state.z[i][1];
+        }
+        _quiet_count = state.quiet_count;
+        _open = state.open;
+        _fade = state.fade;
+    }
+
+
+    // Returns the gate to the open state it was created in, forgetting
+    // any input it has measured.
+    void reset() {
+        for (Section &section : _sections)
+            section.z1 = section.z2 = 0;
+        _quiet_count = 0;
+        _open = true;
+        _fade.set_target(1, 0, GainRampShape::Linear);
+    }
+
+
+    // Applies the gate fade to `count` processor output samples
+    // `stride` floats apart.
+    void process(float *output, size_t count, size_t stride = 1) {
+        if (_fade.ramping() || _fade.gain() != 1)
+            _fade.process(output, count, stride);
+    }
+
+
+private:
+
+
+    // Coefficients and state of a biquad filter section, normalized
+    // so that a0 is one.
+    struct Section {
+        float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        float z1 = 0, z2 = 0;
+    };
+
+
+    ActivityGateSettings _settings;
+    bool _filtered;
+    Section _sections[2];
+    float _open_power;
+    float _close_power;
+    size_t _hold_size;
+    size_t _fade_size;
+    size_t _quiet_count;
+    bool _open;
+    GainRamp _fade;
+
+
+    static float _get_power(float decibels) {
+        return std::pow(10.f, decibels / 10);
+    }
+
+
+    // Returns a highpass biquad section with the specified cutoff and Q
+    // (see the Audio EQ Cookbook). Sections with Qs 1 / (2 cos(pi / 8))
+    // and 1 / (2 cos(3 pi / 8)) make a fourth-order Butterworth filter.
+    static Section _get_highpass_section(
+        double cutoff, double sample_rate, double q) {
+
+        const double w = 2 * M_PI * cutoff / sample_rate;
+        const double alpha = std::sin(w) / (2 * q);
+        const double cos_w = std::cos(w);
+        const double a0 = 1 + alpha;
+
+        Section section;
+        section.b0 = (1 + cos_w) / 2 / a0;
+        section.b1 = -(1 + cos_w) / a0;
+        section.b2 = (1 + cos_w) / 2 / a0;
+        section.a1 = -2 * cos_w / a0;
+        section.a2 = (1 - alpha) / a0;
+        return section;
+
+    }
+
+
+    // Returns the mean power of `count` input samples above the cutoff,
+    // read `stride` floats apart.
+    float _measure(const float *input, size_t count, size_t stride) {
+
+        if (count == 0)
+            return 0;
+
+        float sum = 0;
+
+        if (_filtered) {
+
+            // Transposed direct form II sections, with their states in
+            // locals so they stay in registers.
+            Section s0 = _sections[0];
+            Section s1 = _sections[1];
+
+            for (size_t i = 0; i != count; ++i) {
+
+                const float x = input[i * stride];
+                const float y0 = s0.b0 * x + s0.z1;
+                s0.z1 = s0.b1 * x - s0.a1 * y0 + s0.z2;
+                s0.z2 = s0.b2 * x - s0.a2 * y0;
+
+                const float y1 = s1.b0 * y0 + s1.z1;
+                s1.z1 = s1.b1 * y0 - s1.a1 * y1 + s1.z2;
+                s1.z2 = s1.b2 * y0 - s1.a2 * y1;
+
+                sum += y1 * y1;
+
+            }
+
+            // Flush denormal states, which silent input would
+            // otherwise leave the filter with, and which are slow on
+            // some processors.
+            for (Section *s : { &s0, &s1 }) {
+                if (std::fabs(s->z1) < 1e-20f) s->z1 = 0;
+                if (std::fabs(s->z2) < 1e-20f) s->z2 = 0;
+            }
+
+            _sections[0] = s0;
+            _sections[1] = s1;
+
+        } else {
+
+            for (size_t i = 0; i != count; ++i) {
+                const float x = input[i * stride];
+                sum += x * x;
+            }
+
+        }
+
+        return sum / count;
+
+    }
+
+
+};
+
+
+#endif
@@ -2,7 +2,9 @@
 #define ADVANCING_BUFFER
 
 
+#include <cassert>
 #include <cstring>
+#include "DiagnosticsRing.hpp"
 
 
 using std::size_t;
@@ -21,30 +23,58 @@ public:
 
         _elements = new T[_capacity];
 
-        _buffer_start_index = 0;
         _data_start_offset = 0;
         _data_end_offset = 0;
 
+        _high_water_mark = 0;
+        _diagnostics = nullptr;
+
     }
 
 
-    size_t capacity() {
-        return _capacity;
+    ~AdvancingBuffer() {
+        delete[] _elements;
     }
 
 
-    size_t size() {
-        return _data_end_offset - _data_start_offset;
+    AdvancingBuffer(const AdvancingBuffer &) = delete;
+    AdvancingBuffer &operator=(const AdvancingBuffer &) = delete;
+
+
+    // Sets where this buffer reports overflows, underflows, and new
+    // high-water marks. `block_num` points to the number of the
+    // block being processed by the buffer's owner.
+    void set_diagnostics(
+        DiagnosticsRing *diagnostics, DiagnosticBuffer id, uint16_t channel,
+        const unsigned *block_num) {
+
+        _diagnostics = diagnostics;
+        _diagnostic_id = id;
+        _diagnostic_channel = channel;
+        _diagnostic_block_num = block_num;
+
+    }
+
+
+    // Returns the largest number of elements this buffer has held.
+    size_t high_water_mark() {
+        return _high_water_mark;
+    }
+
+
+    size_t capacity() {
+        return _capacity;
     }
 
 
-    size_t start_index() {
-        return _buffer_start_index + _data_start_offset;
+    // Returns the number of bytes of memory allocated by this buffer.
+    size_t memory_size() {
+        return sizeof(*this) + _capacity * sizeof(T);
     }
 
 
-    size_t end_index() {
-        return _buffer_start_index + _data_end_offset;
+    size_t size() {
+        return _data_end_offset - _data_start_offset;
     }
 
 
@@ -53,10 +83,23 @@ public:
     }
 
 
+    // Extends the buffer by `element_count` elements and returns a
+    // pointer to the first of them. `element_count` must not exceed
+    // the buffer capacity. If there is not room for the extension,
+    // the oldest elements of the buffer are discarded to make room,
+    // and the overflow is reported to the buffer's diagnostics ring.
+    // Since this may be called on the audio render thread, it does
+    // not throw.
     T *extend(size_t element_count) {
 
-        if (this->size() + element_count > _capacity)
-            throw "AdvancingBuffer overflow";
+        assert(element_count <= _capacity);
+
+        if (this->size() + element_count > _capacity) {
+            const size_t discard_count =
+                this->size() + element_count - _capacity;
+            _post(DiagnosticEventType::BufferOverflow, discard_count, 0);
+            _data_start_offset += discard_count;
+        }
 
         // Move data to beginning of buffer if needed to make room
         // for extension.
@@ -68,7 +111,6 @@ public:
             const size_t size = this->size() * sizeof(T);
             std::memmove(dest, src, size);
 
-            _buffer_start_index += _data_start_offset;
             _data_end_offset -= _data_start_offset;
             _data_start_offset = 0;
 
@@ -80,6 +122,12 @@ public:
         // Update data end offset.
         _data_end_offset += element_count;
 
+        if (this->size() > _high_water_mark) {
+            _high_water_mark = this->size();
+            _post(DiagnosticEventType::HighWaterMark, _high_water_mark,
+                  _capacity);
+        }
+
         return result;
 
     }
@@ -97,6 +145,23 @@ public:
     }
 
 
+    // Appends `value_count` values read `stride` elements apart from
+    // `values`, for example one channel of interleaved audio.
+    void append(const T *values, size_t value_count, size_t stride) {
+
+        if (stride == 1) {
+            append(values, value_count);
+            return;
+        }
+
+        T *dest = extend(value_count);
+
+        for (size_t i = 0; i != value_count; ++i)
+            dest[i] = values[i * stride];
+
+    }
+
+
     void append_zeros(size_t zero_count) {
 
         // Extend buffer.
@@ -109,22 +174,46 @@ public:
     }
 
 
+    // Discards the oldest `element_count` elements of the buffer, or
+    // all of them if there are fewer, in which case the underflow is
+    // reported to the buffer's diagnostics ring.
     void discard(size_t element_count) {
 
-        if (element_count > size())
-            throw "AdvancingBuffer underflow";
+        if (element_count > size()) {
+            _post(DiagnosticEventType::BufferUnderflow, element_count, size());
+            element_count = size();
+        }
 
         _data_start_offset += element_count;
 
     }
 
 
+    // Discards all elements of the buffer.
+    void clear() {
+        _data_start_offset = _data_end_offset;
+    }
+
+
 private:
     size_t _capacity;
     T *_elements;
-    size_t _buffer_start_index;
     size_t _data_start_offset;
     size_t _data_end_offset;
+    size_t _high_water_mark;
+
+    DiagnosticsRing *_diagnostics;
+    DiagnosticBuffer _diagnostic_id;
+    uint16_t _diagnostic_channel;
+    const unsigned *_diagnostic_block_num;
+
+
+    void _post(DiagnosticEventType type, size_t value, size_t limit) {
+        if (_diagnostics != nullptr)
+            _diagnostics->post({
+                type, _diagnostic_id, _diagnostic_channel,
+                *_diagnostic_block_num, value, limit });
+    }
 
 
 };
@@ -0,0 +1,111 @@
+#ifndef DENORMAL_GUARD
+#define DENORMAL_GUARD
+
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+
+// Makes the floating point unit of the calling thread flush subnormal
+// numbers to zero for the lifetime of the guard, and restores the
+// previous mode when the guard is destroyed.
+//
+// Arithmetic with subnormal operands or results is many times slower
+// than normal arithmetic on many processors. Audio that decays into
+// silence, such as the input when a microphone is muted, leaves
+// subnormal values in filter histories, which would slow every
+// multiply-add involving them. Flushing them costs nothing audible,
+// since they are more than 700 dB below full scale.
+//
+// On x86 processors the guard sets the flush-to-zero (FTZ) and
+// denormals-are-zero (DAZ) bits of the MXCSR register. On 64-bit ARM
+// processors it sets the flush-to-zero (FZ) bit of the FPCR register,
+// which flushes both subnormal operands and results. On other
+// processors it does nothing. The guard writes the register only if
+// the mode is not already set, since that can be slow.
+
+
+class DenormalGuard {
+
+
+public:
+
+
+    DenormalGuard() :
+        _saved_mode(_get_mode())
+    {
+        if ((_saved_mode & _flush_bits) != _flush_bits)
+            _set_mode(_saved_mode | _flush_bits);
+    }
+
+
+    ~DenormalGuard() {
+        if ((_saved_mode & _flush_bits) != _flush_bits)
+            _set_mode(_saved_mode);
+    }
+
+
+    DenormalGuard(const DenormalGuard &) = delete;
+    DenormalGuard &operator=(const DenormalGuard &) = delete;
+
+
+private:
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+    typedef unsigned int Mode;
+
+    // FTZ is bit 15 of MXCSR and DAZ is bit 6.
+    static const Mode _flush_bits = 0x8040;
+
+    static Mode _get_mode() {
+        return _mm_getcsr();
+    }
+
+    static void _set_mode(Mode mode) {
+        _mm_setcsr(mode);
+    }
+
+#elif defined(__aarch64__)
+
+    typedef uint64_t Mode;
+
+    // FZ is bit 24 of FPCR.
+    static const Mode _flush_bits = Mode(1) << 24;
+
+    static Mode _get_mode() {
+        Mode mode;
+        asm volatile("mrs %0, fpcr" : "=r"(mode));
+        return mode;
+    }
+
+    static void _set_mode(Mode mode) {
+        asm volatile("msr fpcr, %0" : : "r"(mode));
+    }
+
+#else
+
+    typedef unsigned int Mode;
+
+    static const Mode _flush_bits = 0;
+
+    static Mode _get_mode() {
+        return 0;
+    }
+
+    static void _set_mode(Mode) { }
+
+#endif
+
+
+    Mode _saved_mode;
+
+
+};
+
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef DIAGNOSTICS_RING
+#define DIAGNOSTICS_RING
+
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+
+using std::size_t;
+using std::string;
+
+
+enum class DiagnosticEventType : uint8_t {
+    ZeroFill,           // processor output samples set to zero
+    OversizeBlock,      // processor input block larger than max input size, processed in chunks; posted only when its size changes
+    HighWaterMark,      // buffer occupancy reached a new maximum
+    BufferOverflow,     // buffer discarded its oldest data to make room
+    BufferUnderflow,    // buffer asked to discard more data than it held
+    Count               // number of event types, not an event type
+};
+
+
+// Identifies a buffer of a processor in buffer events.
+enum class DiagnosticBuffer : uint8_t {
+    None, Input, OverlapAdder, Highpass, Output, BlockInput, BlockOutput
+};
+
+
+struct DiagnosticEvent {
+    DiagnosticEventType type;
+    DiagnosticBuffer buffer;
+    uint16_t channel;
+    uint32_t block_num;
+    uint64_t value;       // event-specific sample count
+    uint64_t limit;       // limit that `value` is relative to, if any
+};
+
+
+// Lock-free, single-producer, single-consumer ring of diagnostic events.
+//
+// The producer is the audio render thread, which posts events with
+// `post` instead of writing to a console, which might block. The
+// consumer is a non-real-time thread, which periodically drains the
+// ring with `drain` and formats the events with `format`. If the ring
+// is full, `post` drops its event, but the event is still counted.
+//
+// In addition to the ring, the class keeps a count of events of each
+// type and the largest buffer occupancy reported in a `HighWaterMark`
+// event, as a percentage of buffer capacity. These can be read from
+// any thread. A producer that posts repeated events of a type only
+// when something about them changes counts the repeats with `tally`,
+// so that the count still covers every event.
+
+
+class DiagnosticsRing {
+
+
+public:
+
+
+    DiagnosticsRing() :
+        _write_index(0),
+        _read_index(0),
+        _dropped_count(0),
+        _high_water_mark(0)
+    {
+        for (auto &count : _counts)
+            count.store(0, std::memory_order_relaxed);
+    }
+
+
+    // Posts an event. Call only from the producer thread.
+    // Returns `false` if the ring was full and the event was dropped.
+    bool post(const DiagnosticEvent &event) {
+
+        tally(event.type);
+
+        if (event.type == DiagnosticEventType::HighWaterMark &&
+                event.limit != 0) {
+            const unsigned percent =
+                static_cast<unsigned>(100 * event.value / event.limit);
+            if (percent > _high_water_mark.load(std::memory_order_relaxed))
+                _high_water_mark.store(percent, std::memory_order_relaxed);
+        }
+
+        const size_t write_index =
+            _write_index.load(std::memory_order_relaxed);
+        const size_t read_index =
+            _read_index.load(std::memory_order_acquire);
+
+        if (write_index - read_index == _capacity) {
+            _dropped_count.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        _events[write_index & _index_mask] = event;
+        _write_index.store(write_index + 1, std::memory_order_release);
+
+        return true;
+
+    }
+
+
+    // Counts an event without posting it. Call only from the producer
+    // thread.
+    void tally(DiagnosticEventType type) {
+        _counts[static_cast<size_t>(type)].fetch_add(
+            1, std::memory_order_relaxed);
+    }
+
+
+    // Calls `handler` for each event in the ring, oldest first, and
+    // removes the events from the ring. Call only from the consumer
+    // thread. Returns the number of events handled.
+    template <class Handler>
+    size_t drain(Handler handler) {
+
+        size_t read_index = _read_index.load(std::memory_order_relaxed);
+        const size_t write_index =
+            _write_index.load(std::memory_order_acquire);
+        const size_t count = write_index - read_index;
+
+        while (read_index != write_index) {
+            handler(_events[read_index & _index_mask]);
+            ++read_index;
+            _read_index.store(read_index, std::memory_order_release);
+        }
+
+        return count;
+
+    }
+
+
+    uint64_t count(DiagnosticEventType type) const {
+        return _counts[static_cast<size_t>(type)].load(
+            std::memory_order_relaxed);
+    }
+
+
+    uint64_t dropped_count() const {
+        return _dropped_count.load(std::memory_order_relaxed);
+    }
+
+
+    // Returns the largest buffer occupancy reported so far, as a
+    // percentage of buffer capacity.
+    unsigned high_water_mark() const {
+        return _high_water_mark.load(std::memory_order_relaxed);
+    }
+
+
+    static string format(const DiagnosticEvent &event) {
+
+        std::ostringstream s;
+
+        s << "SongFinderProcessor " << event.channel << " block " <<
+            event.block_num << ": ";
+
+        switch (event.type) {
+
+            case DiagnosticEventType::ZeroFill:
+                s << "zero-filled " << event.value << " of " <<
+                    event.limit << " output samples";
+                break;
+
+            case DiagnosticEventType::OversizeBlock:
+                s << "input block of " << event.value <<
+                    " samples exceeds max input size " << event.limit;
+                break;
+
+            case DiagnosticEventType::HighWaterMark:
+                s << _buffer_name(event.buffer) <<
+                    " buffer high-water mark " << event.value << " of " <<
+                    event.limit << " samples";
+                break;
+
+            case DiagnosticEventType::BufferOverflow:
+                s << _buffer_name(event.buffer) <<
+                    " buffer overflow, discarded " << event.value <<
+                    " samples";
+                break;
+
+            case DiagnosticEventType::BufferUnderflow:
+                s << _buffer_name(event.buffer) <<
+                    " buffer underflow, asked to discard " << event.value <<
+                    " samples but had " << event.limit;
+                break;
+
+            default:
+                s << "unknown event";
+                break;
+
+        }
+
+        return s.str();
+
+    }
+
+
+private:
+
+
+    // Ring capacity, which must be a power of two.
+    static const size_t _capacity = 256;
+    static const size_t _index_mask = _capacity - 1;
+
+    static const size_t _type_count =
+        static_cast<size_t>(DiagnosticEventType::Count);
+
+    DiagnosticEvent _events[_capacity];
+
+    // Free-running event indices. The ring holds the events with
+    // indices in [_read_index, _write_index).
+    std::atomic<size_t> _write_index;
+    std::atomic<size_t> _read_index;
+
+    std::atomic<uint64_t> _counts[_type_count];
+    std::atomic<uint64_t> _dropped_count;
+    std::atomic<unsigned> _high_water_mark;
+
+
+    static const char *_buffer_name(DiagnosticBuffer buffer) {
+
+        switch (buffer) {
+            case DiagnosticBuffer::Input: return "input";
+            case DiagnosticBuffer::OverlapAdder: return "overlap-adder";
+            case DiagnosticBuffer::Highpass: return "highpass";
+            case DiagnosticBuffer::Output: return "output";
+            case DiagnosticBuffer::BlockInput: return "block input";
+            case DiagnosticBuffer::BlockOutput: return "block output";
+            default: return "unknown";
+        }
+
+    }
+
+
+};
+
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef FILTER_DESIGN
+#define FILTER_DESIGN
+
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+
+using std::size_t;
+using std::vector;
+
+
+// Kaiser window design of linear-phase FIR lowpass and highpass filters.
+//
+// The precomputed filters of `HbaFilters.hpp` are equiripple designs,
+// which are the shortest filters that meet their specifications. The
+// functions in this file design filters at run time instead, for
+// specifications that have no precomputed filters. Kaiser window
+// designs are somewhat longer than equiripple designs for the same
+// specification, but they are simple and robust to compute.
+//
+// A specification comprises a stopband attenuation in decibels and a
+// transition band, given by its edges in hertz. The same attenuation
+// applies to the passband ripple. All designs have odd lengths, and
+// hence whole-sample group delays.
+
+
+// Returns the zeroth-order modified Bessel function of the first kind.
+inline double bessel_i0(double x) {
+
+    // Sum the power series until its terms become negligible.
+    const double y = x * x / 4;
+    double term = 1;
+    double sum = 1;
+
+    for (unsigned k = 1; term > 1e-12 * sum; ++k) {
+        term *= y / (k * k);
+        sum += term;
+    }
+
+    return sum;
+
+}
+
+
+// Returns the Kaiser window beta for a stopband attenuation in decibels.
+inline double get_kaiser_beta(double attenuation) {
+    if (attenuation > 50)
+        return .1102 * (attenuation - 8.7);
+    else if (attenuation >= 21)
+        return .5842 * std::pow(attenuation - 21, .4) +
+            .07886 * (attenuation - 21);
+    else
+        return 0;
+}
+
+
+// Returns the odd filter length required for a stopband attenuation
+// in decibels and a transition band width in hertz.
+inline size_t get_kaiser_length(
+    double attenuation, double transition_width, double sample_rate) {
+
+    const double width = 2 * M_PI * transition_width / sample_rate;
+    size_t length =
+        static_cast<size_t>(std::ceil((attenuation - 7.95) / (2.285 * width))) + 1;
+
+    if (length % 2 == 0)
+        length += 1;
+
+    return length;
+
+}
+
+
+// Returns a Kaiser window of the specified length and beta.
+inline vector<double> get_kaiser_window(size_t length, double beta) {
+
+    vector<double> window(length);
+    const double m = length - 1;
+    const double scale = 1 / bessel_i0(beta);
+
+    for (size_t i = 0; i != length; ++i) {
+        const double r = 2 * i / m - 1;
+        window[i] = bessel_i0(beta * std::sqrt(1 - r * r)) * scale;
+    }
+
+    return window;
+
+}
+
+
+// Returns a windowed ideal lowpass filter with a cutoff in cycles per
+// sample, in double precision.
+inline vector<double> _design_lowpass(
+    size_t length, double cutoff, double beta) {
+
+    const vector<double> window = get_kaiser_window(length, beta);
+    vector<double> filter(length);
+    const double m = (length - 1) / 2.;
+
+    for (size_t i = 0; i != length; ++i) {
+        const double t = i - m;
+        const double sinc = t == 0 ?
+            2 * cutoff : std::sin(2 * M_PI * cutoff * t) / (M_PI * t);
+        filter[i] = sinc * window[i];
+    }
+
+    return filter;
+
+}
+
+
+// Designs a lowpass filter with passband edge `pass_edge` and stopband
+// edge `stop_edge`, both in hertz, with unity passband gain.
+inline vector<float> design_lowpass(
+    double pass_edge, double stop_edge, double attenuation,
+    double sample_rate) {
+
+    const size_t length = get_kaiser_length(
+        attenuation, stop_edge - pass_edge, sample_rate);
+    const double cutoff = (pass_edge + stop_edge) / 2 / sample_rate;
+
+    const vector<double> filter = _design_lowpass(
+        length, cutoff, get_kaiser_beta(attenuation));
+
+    return vector<float>(filter.begin(), filter.end());
+
+}
+
+
+// Designs a highpass filter with stopband edge `stop_edge` and passband
+// edge `pass_edge`, both in hertz, with unity passband gain. The filter
+// is the spectral inversion of a lowpass filter with the same
+// transition band.
+inline vector<float> design_highpass(
+    double stop_edge, double pass_edge, double attenuation,
+    double sample_rate) {
+
+    const size_t length = get_kaiser_length(
+        attenuation, pass_edge - stop_edge, sample_rate);
+    const double cutoff = (stop_edge + pass_edge) / 2 / sample_rate;
+
+    vector<double> filter = _design_lowpass(
+        length, cutoff, get_kaiser_beta(attenuation));
+
+    for (double &c : filter)
+        c = -c;
+    filter[(length - 1) / 2] += 1;
+
+    return vector<float>(filter.begin(), filter.end());
+
+}
+
+
+#endif
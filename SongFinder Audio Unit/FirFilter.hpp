@@ -10,6 +10,23 @@ using std::size_t;
 using std::vector;
 
 
+// Inner loop implementations of `FirFilter::process`. All of the
+// implementations produce the same outputs, but which is fastest
+// depends on the machine and the filter length. See `SongFinderTuner`.
+enum class FirKernel {
+    Direct,     // one output frame per pass over the coefficients
+    Blocked     // four output frames per pass over the coefficients
+};
+
+
+// Finite impulse response filter of one or more channels of audio.
+//
+// A filter of more than one channel filters interleaved frames of its
+// input buffer into interleaved frames of its output buffer, loading
+// each coefficient once for all of the channels of a frame. Each
+// channel is filtered exactly as by a one-channel filter.
+
+
 class FirFilter {
 
 
@@ -20,13 +37,18 @@ public:
 
 		const vector<float> &coeffs,
 		AdvancingBuffer<float> &input_buffer,
-		AdvancingBuffer<float> &output_buffer
+		AdvancingBuffer<float> &output_buffer,
+		FirKernel kernel = FirKernel::Direct,
+		unsigned channel_count = 1
 
 	) :
 
 		_coeffs(coeffs),
 		_input_buffer(input_buffer),
-		_output_buffer(output_buffer)
+		_output_buffer(output_buffer),
+		_kernel(kernel),
+		_channel_count(channel_count),
+		_idle(false)
 	
 	{
 
@@ -35,27 +57,125 @@ public:
     	_reversed_coeffs = _reverse(_coeffs);
 
     	// Prime input buffer with zeros so filter can compute
-    	// one output sample for each subsequent input sample.
-    	_input_buffer.append_zeros(_length - 1);
+    	// one output frame for each subsequent input frame.
+    	_input_buffer.append_zeros((_length - 1) * _channel_count);
 
     }
 
 
+    ~FirFilter() {
+        delete[] _reversed_coeffs;
+    }
+
+
+    FirFilter(const FirFilter &) = delete;
+    FirFilter &operator=(const FirFilter &) = delete;
+
+
     vector<float> coeffs() {
         return vector<float>(_coeffs);
     }
 
 
+    size_t length() {
+        return _length;
+    }
+
+
+    // Returns the number of bytes of memory allocated by this filter,
+    // not including its input and output buffers.
+    size_t memory_size() {
+        return sizeof(*this) + 2 * _length * sizeof(float);
+    }
+
+
+    FirKernel kernel() {
+        return _kernel;
+    }
+
+
+    unsigned channel_count() {
+        return _channel_count;
+    }
+
+
+    // Sets whether this filter is idle. An idle filter consumes its
+    // input as usual but outputs zeros instead of computing anything.
+    // Its input buffer still holds the most recent input, so when it
+    // stops idling its output is exactly what it would have been had
+    // it never idled.
+    void set_idle(bool idle) {
+        _idle = idle;
+    }
+
+
+    bool idle() {
+        return _idle;
+    }
+
+
+    // Primes the input buffer, which must be empty, with zeros as when
+    // the filter was created, so that the filter starts over.
+    void reset() {
+        _input_buffer.append_zeros((_length - 1) * _channel_count);
+    }
+
+
     void process() {
 
-    	// Get the number of output samples that we will produce.
-    	const size_t output_count = _input_buffer.size() - _length + 1;
+    	const size_t channel_count = _channel_count;
+
+    	// Get the number of output frames that we will produce.
+    	const size_t output_count =
+    	    _input_buffer.size() / channel_count - _length + 1;
+    	const size_t sample_count = output_count * channel_count;
 
     	// Get pointer to first input sample.
     	const float *x = _input_buffer.data();
 
     	// Extend output buffer and get pointer to first output sample.
-    	float *y = _output_buffer.extend(output_count);
+    	float *y = _output_buffer.extend(sample_count);
+
+    	if (_idle)
+    	    for (size_t i = 0; i != sample_count; ++i)
+    	        y[i] = 0;
+    	else if (channel_count == 2)
+    	    _process<2>(x, y, output_count);
+    	else
+    	    _process<1>(x, y, output_count);
+
+    	_input_buffer.discard(sample_count);
+
+    }
+
+
+private:
+
+
+	vector<float> _coeffs;
+    size_t _length;
+    float *_reversed_coeffs;
+	AdvancingBuffer<float> &_input_buffer;
+    AdvancingBuffer<float> &_output_buffer;
+    FirKernel _kernel;
+    unsigned _channel_count;
+    bool _idle;
+
+
+    // Filters `output_count` frames of `C` channels. The channel count
+    // is a template parameter so that the compiler can unroll the
+    // loops over channels and keep the sums in registers.
+    template <size_t C>
+    void _process(const float *x, float *y, size_t output_count) {
+    	if (_kernel == FirKernel::Blocked)
+    	    _process_blocked<C>(x, y, output_count);
+    	else
+    	    _process_direct<C>(x, y, output_count);
+    }
+
+
+    template <size_t C>
+    void _process_direct(const float *x, float *y, size_t output_count) {
 
     	const float *reversed_coeffs = _reversed_coeffs;
     	const float *reversed_coeffs_end = reversed_coeffs + _length;
@@ -65,35 +185,71 @@ public:
             const float *z = x;
 
             // Get pointer to filter coefficient that will multiply
-            // first sample of input record.
+            // first frame of input record.
             const float *c = reversed_coeffs;
 
-            *y = 0;
+            float sums[C] = {};
 
-            // Compute inner product of input samples and filter coefficients.
+            // Compute inner products of input frames and filter
+            // coefficients, one per channel.
             while (c != reversed_coeffs_end) {
-                *y += *z++ * *c;
-                ++c;
+                const float ck = *c++;
+                for (size_t j = 0; j != C; ++j)
+                    sums[j] += z[j] * ck;
+                z += C;
             }
 
-            ++y;
-		    ++x;
+            for (size_t j = 0; j != C; ++j)
+                y[j] = sums[j];
 
-    	}
+            y += C;
+		    x += C;
 
-    	_input_buffer.discard(output_count);
+    	}
 
     }
 
 
-private:
+    template <size_t C>
+    void _process_blocked(const float *x, float *y, size_t output_count) {
 
+    	// Compute output frames four at a time, so that each filter
+    	// coefficient is loaded once for four multiply-adds per
+    	// channel. With interleaved channels the samples of four
+    	// consecutive frames are contiguous, so each coefficient
+    	// multiplies a contiguous run of `4 * C` input samples. The
+    	// sums are accumulated in the same order as in
+    	// `_process_direct`, so the two methods produce the same
+    	// results.
+
+    	const float *c = _reversed_coeffs;
+    	const size_t length = _length;
+    	const size_t block_count = output_count / 4;
+
+    	for (size_t i = 0; i != block_count; ++i) {
+
+    	    float sums[4 * C] = {};
+
+    	    for (size_t k = 0; k != length; ++k) {
+    	        const float ck = c[k];
+    	        const float *z = x + k * C;
+    	        for (size_t j = 0; j != 4 * C; ++j)
+    	            sums[j] += z[j] * ck;
+    	    }
+
+    	    for (size_t j = 0; j != 4 * C; ++j)
+    	        y[j] = sums[j];
+
+    	    x += 4 * C;
+    	    y += 4 * C;
+
+    	}
+
+    	// Compute any remaining output frames one at a time.
+    	_process_direct<C>(x, y, output_count - 4 * block_count);
+
+    }
 
-	vector<float> _coeffs;
-    size_t _length;
-    float *_reversed_coeffs;
-	AdvancingBuffer<float> &_input_buffer;
-    AdvancingBuffer<float> &_output_buffer;
 
     static float *_reverse(vector<float> &v) {
     	float *result = new float[v.size()];
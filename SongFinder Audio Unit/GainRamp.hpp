@@ -0,0 +1,296 @@
+#ifndef GAIN_RAMP
+#define GAIN_RAMP
+
+
+#include <cmath>
+#include <cstddef>
+
+
+using std::size_t;
+
+
+enum class GainRampShape {
+    Linear,         // gain factor changes linearly
+    Exponential     // gain in decibels changes linearly
+};
+
+
+// Gain that moves smoothly from one value to another.
+//
+// `set_target` starts a ramp from the current gain factor to a target
+// gain factor over a given number of samples, and `process` applies
+// the gain to successive blocks of samples, continuing ramps across
+// blocks. Once a ramp completes, `process` applies a constant gain
+// with the same simple loop that it would without ramps. While a ramp
+// is in progress, the loop processes a few samples per pass, computing
+// the gain factor for each from the gain at the start of the pass with
+// a precomputed offset or ratio. The samples of a pass thus do not
+// depend on each other, and the loop still vectorizes.
+//
+// A variant of `process` also measures the peak magnitude and the sum
+// of squares of the samples it outputs, in the same loop, so that a
+// caller that meters its output need not make another pass over it.
+// Both variants can process samples that are a fixed stride apart, for
+// example one channel of interleaved audio. The loops are compiled
+// separately for a stride of one, so contiguous samples are processed
+// exactly as before.
+
+
+class GainRamp {
+
+
+public:
+
+
+    GainRamp(float gain = 1) :
+        _gain(gain),
+        _target(gain),
+        _remaining(0),
+        _shape(GainRampShape::Linear)
+    {
+        for (size_t i = 0; i != _lane_count; ++i) {
+            _increments[i] = 0;
+            _ratios[i] = 1;
+        }
+    }
+
+
+    float gain() const {
+        return _gain;
+    }
+
+
+    float target() const {
+        return _target;
+    }
+
+
+    bool ramping() const {
+        return _remaining != 0;
+    }
+
+
+    // Starts a ramp from the current gain to `target` that completes
+    // after `ramp_size` samples. A ramp size of zero sets the gain
+    // immediately. Exponential ramps require positive gains, and fall
+    // back to linear ramps for nonpositive ones.
+    void set_target(float target, size_t ramp_size, GainRampShape shape) {
+
+        _target = target;
+
+        if (ramp_size == 0 || target == _gain) {
+            _gain = target;
+            _remaining = 0;
+            return;
+        }
+
+        if (shape == GainRampShape::Exponential && (_gain <= 0 || target <= 0))
+            shape = GainRampShape::Linear;
+
+        _shape = shape;
+        _remaining = ramp_size;
+
+        if (shape == GainRampShape::Linear) {
+            const float increment = (target - _gain) / ramp_size;
+            for (size_t i = 0; i != _lane_count; ++i)
+                _increments[i] = (i + 1) * increment;
+
+        } else {
+            const double ratio = std::pow(
+                static_cast<double>(target) / _gain, 1. / ramp_size);
+            double power = 1;
+            for (size_t i = 0; i != _lane_count; ++i) {
+                power *= ratio;
+                _ratios[i] = static_cast<float>(power);
+            }
+        }
+
+    }
+
+
+    // Multiplies `count` samples `stride` floats apart in place by the
+    // gain.
+    void process(float *samples, size_t count, size_t stride = 1) {
+        float peak = 0, sum = 0;
+        if (stride == 1)
+            _process<false>(samples, count, peak, sum, _UnitStride());
+        else
+            _process<false>(samples, count, peak, sum, _Stride { stride });
+    }
+
+
+    // Multiplies `count` samples `stride` floats apart in place by the
+    // gain, raising `peak` to the largest output magnitude if that is
+    // larger, and adding the squares of the outputs to `sum`.
+    void process(
+        float *samples, size_t count, float &peak, float &sum,
+        size_t stride = 1) {
+        if (stride == 1)
+            _process<true>(samples, count, peak, sum, _UnitStride());
+        else
+            _process<true>(samples, count, peak, sum, _Stride { stride });
+    }
+
+
+private:
+
+
+    static const size_t _lane_count = 4;
+
+    float _gain;
+    float _target;
+    size_t _remaining;
+    GainRampShape _shape;
+
+    // `_increments[i]` is the gain increment over `i + 1` samples for
+    // linear ramps
+    float _increments[_lane_count];
+
+    // `_ratios[i]` is the gain ratio over `i + 1` samples for
+    // exponential ramps
+    float _ratios[_lane_count];
+
+
+    // Sample index to array offset mappings.
+
+    struct _UnitStride {
+        size_t operator()(size_t i) const { return i; }
+    };
+
+    struct _Stride {
+        size_t stride;
+        size_t operator()(size_t i) const { return i * stride; }
+    };
+
+
+    template <bool measured>
+    static void _measure(float y, float &peak, float &sum) {
+        if (measured) {
+            const float magnitude = std::fabs(y);
+            peak = magnitude > peak ? magnitude : peak;
+            sum += y * y;
+        }
+    }
+
+
+    template <bool measured, class Index>
+    void _process(
+        float *samples, size_t count, float &peak, float &sum,
+        Index index) {
+
+        size_t k = 0;
+
+        if (_remaining != 0) {
+
+            const size_t n = count < _remaining ? count : _remaining;
+
+            if (_shape == GainRampShape::Linear)
+                _process_linear<measured>(samples, n, peak, sum, index);
+            else
+                _process_exponential<measured>(samples, n, peak, sum, index);
+
+            _remaining -= n;
+
+            // Avoid accumulated rounding error.
+            if (_remaining == 0)
+                _gain = _target;
+
+            k = n;
+
+        }
+
+        // Accumulate in locals, so the compiler need not assume that
+        // `peak` and `sum` alias `samples`. The sum is accumulated
+        // sequentially, sample by sample, so it is the same as that of
+        // a separate pass over the output.
+        const float gain = _gain;
+        float p = peak, s = sum;
+        for ( ; k < count; ++k) {
+            const float y = samples[index(k)] * gain;
+            samples[index(k)] = y;
+            _measure<measured>(y, p, s);
+        }
+        peak = p;
+        sum = s;
+
+    }
+
+
+    // Each ramp pass processes `_lane_count` samples, each scaled by
+    // the gain at the start of the pass plus a fixed increment or times
+    // a fixed ratio, and then advances the gain by the increment or
+    // ratio for a whole pass.
+
+
+    template <bool measured, class Index>
+    void _process_linear(
+        float *samples, size_t n, float &peak, float &sum, Index index) {
+
+        float gain = _gain;
+        const float *increments = _increments;
+        const float pass_increment = increments[_lane_count - 1];
+        float p = peak, s = sum;
+
+        size_t i = 0;
+
+        for ( ; i + _lane_count <= n; i += _lane_count) {
+            for (size_t j = 0; j != _lane_count; ++j) {
+                const float y = samples[index(i + j)] * (gain + increments[j]);
+                samples[index(i + j)] = y;
+                _measure<measured>(y, p, s);
+            }
+            gain += pass_increment;
+        }
+
+        for ( ; i != n; ++i) {
+            gain += increments[0];
+            const float y = samples[index(i)] * gain;
+            samples[index(i)] = y;
+            _measure<measured>(y, p, s);
+        }
+
+        _gain = gain;
+        peak = p;
+        sum = s;
+
+    }
+
+
+    template <bool measured, class Index>
+    void _process_exponential(
+        float *samples, size_t n, float &peak, float &sum, Index index) {
+
+        float gain = _gain;
+        const float *ratios = _ratios;
+        const float pass_ratio = ratios[_lane_count - 1];
+        float p = peak, s = sum;
+
+        size_t i = 0;
+
+        for ( ; i + _lane_count <= n; i += _lane_count) {
+            for (size_t j = 0; j != _lane_count; ++j) {
+                const float y = samples[index(i + j)] * (gain * ratios[j]);
+                samples[index(i + j)] = y;
+                _measure<measured>(y, p, s);
+            }
+            gain *= pass_ratio;
+        }
+
+        for ( ; i != n; ++i) {
+            gain *= ratios[0];
+            const float y = samples[index(i)] * gain;
+            samples[index(i)] = y;
+            _measure<measured>(y, p, s);
+        }
+
+        _gain = gain;
+        peak = p;
+        sum = s;
+
+    }
+
+
+};
+
+
+#endif
@@ -3,13 +3,34 @@
 
 
 #include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
 #include "AdvancingBuffer.hpp"
 
 
+using std::ptrdiff_t;
 using std::size_t;
 using std::vector;
 
 
+// Inner loop implementations of `Interpolator::process`. All of the
+// implementations produce the same outputs, but which is fastest
+// depends on the machine and the filter length. See `SongFinderTuner`.
+enum class InterpolatorKernel {
+    Direct,       // strided access to reversed filter
+    Polyphase     // contiguous access to per-phase subfilters
+};
+
+
+// Polyphase interpolator of one or more channels of audio.
+//
+// An interpolator of more than one channel reads interleaved frames
+// from its input buffer and loads each filter coefficient once for all
+// of the channels of a frame. Each channel is interpolated exactly as
+// by a one-channel interpolator.
+
+
 class Interpolator {
 
 
@@ -21,29 +42,55 @@ public:
         unsigned interpolation_factor,
 		const vector<float> &filter,
 		AdvancingBuffer<float> &input_buffer,
-		AdvancingBuffer<float> &output_buffer
+		AdvancingBuffer<float> &output_buffer,
+		InterpolatorKernel kernel = InterpolatorKernel::Direct,
+		unsigned channel_count = 1
 
 	) :
 
 	    _interpolation_factor(interpolation_factor),
 		_filter(filter),
 		_input_buffer(input_buffer),
-		_output_buffer(output_buffer)
+		_output_buffer(output_buffer),
+		_kernel(kernel),
+		_channel_count(channel_count),
+		_idle(false)
 	
 	{
 
     	_filter_length = _filter.size();
 
-    	const float n = static_cast<float>(_filter_length);
     	_input_record_size =
-		    static_cast<size_t>(ceil(n / _interpolation_factor));
+    	    get_input_record_size(_filter_length, _interpolation_factor);
 
     	_reversed_filter = _reverse(_filter);
+    	_subfilters = _create_subfilters();
 
     	// Prime input buffer with zeros so interpolator can compute
-    	// `interpolation_factor` output samples for each subsequent
-    	// input sample.
-    	_input_buffer.append_zeros(_input_record_size - 1);
+    	// `interpolation_factor` output frames for each subsequent
+    	// input frame.
+    	_input_buffer.append_zeros((_input_record_size - 1) * _channel_count);
+
+    }
+
+
+    ~Interpolator() {
+        delete[] _reversed_filter;
+        delete[] _subfilters;
+    }
+
+
+    Interpolator(const Interpolator &) = delete;
+    Interpolator &operator=(const Interpolator &) = delete;
+
+
+    // Returns the number of input samples an interpolator requires to
+    // produce each record of `interpolation_factor` output samples.
+    static size_t get_input_record_size(
+        size_t filter_length, unsigned interpolation_factor) {
+
+    	const float n = static_cast<float>(filter_length);
+    	return static_cast<size_t>(ceil(n / interpolation_factor));
 
     }
 
@@ -58,18 +105,200 @@ public:
     }
 
 
+    size_t filter_length() {
+        return _filter_length;
+    }
+
+
+    // Returns the number of bytes of memory allocated by this
+    // interpolator, not including its input and output buffers.
+    size_t memory_size() {
+        return sizeof(*this) + 3 * _filter_length * sizeof(float);
+    }
+
+
+    InterpolatorKernel kernel() {
+        return _kernel;
+    }
+
+
+    unsigned channel_count() {
+        return _channel_count;
+    }
+
+
+    // Sets whether this interpolator is idle. An idle interpolator
+    // consumes its input as usual but outputs zeros instead of
+    // computing anything.
+    void set_idle(bool idle) {
+        _idle = idle;
+    }
+
+
+    bool idle() {
+        return _idle;
+    }
+
+
+    // Primes the input buffer, which must be empty, with zeros as when
+    // the interpolator was created, so that the interpolator starts
+    // over.
+    void reset() {
+        _input_buffer.append_zeros((_input_record_size - 1) * _channel_count);
+    }
+
+
     void process() {
+        float *const outputs[_max_channel_count] = { };
+        process(outputs, 0);
+    }
+
+
+    // Processes all available input of a one-channel interpolator. See
+    // below.
+    size_t process(float *output, size_t output_size, size_t output_stride = 1) {
+        return process(&output, output_size, output_stride);
+    }
+
+
+    // Processes all available input, writing as many output frames
+    // as possible (up to `output_size`) directly to `outputs`, one
+    // array per channel, and appending the rest to the output buffer,
+    // interleaved. Output is written to `outputs` only if the output
+    // buffer is initially empty, since otherwise the buffered frames
+    // must precede the new ones. Successive output samples are written
+    // `output_stride` floats apart, so that each output can be one
+    // channel of interleaved audio. Returns the number of frames
+    // written to `outputs`.
+    size_t process(
+        float *const *outputs, size_t output_size, size_t output_stride = 1) {
+
+    	const unsigned interpolation_factor = _interpolation_factor;
+    	const size_t channel_count = _channel_count;
+
+    	if (_output_buffer.size() != 0)
+    	    output_size = 0;
 
     	// Get the number of output records that we will produce.
     	const size_t output_record_count =
-    		_input_buffer.size() - _input_record_size + 1;
+    		_input_buffer.size() / channel_count - _input_record_size + 1;
+
+    	// Get pointer to last frame of first input record.
+    	const float *x =
+    	    _input_buffer.data() + (_input_record_size - 1) * channel_count;
+
+    	// Compute complete output records that fit in `outputs`
+    	// directly into them.
+    	size_t direct_record_count = output_size / interpolation_factor;
+    	if (direct_record_count > output_record_count)
+    	    direct_record_count = output_record_count;
+    	_compute(x, outputs, direct_record_count, output_stride);
+
+    	// Compute the remaining output records into the output buffer.
+    	const size_t buffered_record_count =
+    	    output_record_count - direct_record_count;
+    	float *y = _output_buffer.extend(
+    		buffered_record_count * interpolation_factor * channel_count);
+    	float *const buffered_outputs[_max_channel_count] = { y, y + 1 };
+    	_compute(
+    	    x + direct_record_count * channel_count, buffered_outputs,
+    	    buffered_record_count, channel_count);
+
+    	// Move frames from the start of the output buffer to the end
+    	// of `outputs` to fill them as far as possible. There are fewer
+    	// of these than `interpolation_factor`.
+    	size_t output_count = direct_record_count * interpolation_factor;
+    	size_t move_count = output_size - output_count;
+    	if (move_count > _output_buffer.size() / channel_count)
+    	    move_count = _output_buffer.size() / channel_count;
+    	if (move_count != 0) {
+    	    for (size_t j = 0; j != channel_count; ++j) {
+    	        float *z = outputs[j] + output_count * output_stride;
+    	        for (size_t i = 0; i != move_count; ++i)
+    	            z[i * output_stride] = y[i * channel_count + j];
+    	    }
+    	    _output_buffer.discard(move_count * channel_count);
+    	    output_count += move_count;
+    	}
 
-    	// Get pointer to last sample of first input record.
-    	const float *x = _input_buffer.data() + _input_record_size - 1;
+    	_input_buffer.discard(output_record_count * channel_count);
 
-    	// Extend output buffer and get pointer to first output sample.
-    	float *y = _output_buffer.extend(
-    		output_record_count * _interpolation_factor);
+    	return output_count;
+
+    }
+
+
+private:
+
+
+    unsigned _interpolation_factor;
+	vector<float> _filter;
+    size_t _filter_length;
+    float *_reversed_filter;
+	AdvancingBuffer<float> &_input_buffer;
+    AdvancingBuffer<float> &_output_buffer;
+    InterpolatorKernel _kernel;
+    unsigned _channel_count;
+    bool _idle;
+
+    static const unsigned _max_channel_count = 2;
+
+    // The number of input samples required to produce each record
+	// of _interpolation_factor consecutive output samples.
+    size_t _input_record_size;
+
+    // `_interpolation_factor` subfilters, stored one after another.
+    // Subfilter `j` comprises reversed filter coefficients `j`,
+    // `j + _interpolation_factor`, `j + 2 * _interpolation_factor`,
+    // and so on, and computes sample `j` of each output record.
+    float *_subfilters;
+
+
+    // Computes output records, writing their samples `stride` floats
+    // apart. Each output sample is computed whole and written once,
+    // so a stride costs nothing but an address computation.
+    void _compute(
+        const float *x, float *const *y, size_t output_record_count,
+        size_t stride) {
+    	if (_idle)
+    	    _zero(y, output_record_count * _interpolation_factor, stride);
+    	else if (_channel_count == 2)
+    	    _compute<2>(x, y, output_record_count, stride);
+    	else
+    	    _compute<1>(x, y, output_record_count, stride);
+    }
+
+
+    template <size_t C>
+    void _compute(
+        const float *x, float *const *y, size_t output_record_count,
+        size_t stride) {
+    	if (_kernel == InterpolatorKernel::Polyphase)
+    	    _process_polyphase<C>(x, y, output_record_count, stride);
+    	else
+    	    _process_direct<C>(x, y, output_record_count, stride);
+    }
+
+
+    void _zero(float *const *y, size_t count, size_t stride) {
+    	for (unsigned l = 0; l != _channel_count; ++l)
+    	    for (size_t i = 0; i != count; ++i)
+    	        y[l][i * stride] = 0;
+    }
+
+
+    // The kernels below compute the outputs of all `C` channels of a
+    // frame together, so that each filter coefficient is loaded once
+    // per frame rather than once per sample.
+
+    template <size_t C>
+    void _process_direct(
+	    const float *x, float *const *outputs, size_t output_record_count,
+	    size_t stride) {
+
+    	float *y[C];
+    	for (size_t l = 0; l != C; ++l)
+    	    y[l] = outputs[l];
 
     	const unsigned interpolation_factor = _interpolation_factor;
     	const float *reversed_filter = _reversed_filter;
@@ -122,44 +351,97 @@ public:
         		const float *z = x;
 
 				// Get pointer to filter coefficient that will multiply
-				// last sample of input record.
+				// last frame of input record.
     		    const float *f = reversed_filter + j;
 
-    		    *y = 0;
+    		    float sums[C] = { };
 
-    		    // Compute inner product of filter coefficients with
-    		    // input samples, moving backward in time.
+    		    // Compute inner products of filter coefficients with
+    		    // input frames, moving backward in time.
 				while (f < reversed_filter_end) {
-						*y += *z-- * *f;
+				        const float c = *f;
+				        for (size_t l = 0; l != C; ++l)
+				            sums[l] += z[l] * c;
+				        z -= C;
 						f += interpolation_factor;
 				}
 
-				++y;
+				for (size_t l = 0; l != C; ++l) {
+				    *y[l] = sums[l];
+				    y[l] += stride;
+				}
 
     		}
 
-		    ++x;
+		    x += C;
 
     	}
 
-    	_input_buffer.discard(output_record_count);
+    }
+
+
+    template <size_t C>
+    void _process_polyphase(
+	    const float *x, float *const *outputs, size_t output_record_count,
+	    size_t stride) {
+
+    	// This method computes the same inner products as
+    	// `_process_direct`, in the same order, but reads the
+    	// coefficients of each inner product from a contiguous
+    	// subfilter rather than with a stride of `_interpolation_factor`.
+
+    	const unsigned interpolation_factor = _interpolation_factor;
+    	const size_t filter_length = _filter_length;
+
+    	float *y[C];
+    	for (size_t l = 0; l != C; ++l)
+    	    y[l] = outputs[l];
+
+    	for (size_t i = 0; i != output_record_count; ++i) {
+
+    	    const float *f = _subfilters;
+
+    		for (unsigned j = 0; j != interpolation_factor; ++j) {
+
+    		    const size_t n =
+    		        (filter_length - j + interpolation_factor - 1) /
+    		        interpolation_factor;
+
+    		    float sums[C] = { };
+    		    for (size_t k = 0; k != n; ++k) {
+    		        const float *z = x - static_cast<ptrdiff_t>(k * C);
+    		        for (size_t l = 0; l != C; ++l)
+    		            sums[l] += z[l] * f[k];
+    		    }
+
+    		    for (size_t l = 0; l != C; ++l) {
+    		        *y[l] = sums[l];
+    		        y[l] += stride;
+    		    }
+    		    f += n;
+
+    		}
+
+    		x += C;
+
+    	}
 
     }
 
 
-private:
+    float *_create_subfilters() {
 
+    	float *subfilters = new float[_filter_length];
+    	float *q = subfilters;
 
-    unsigned _interpolation_factor;
-	vector<float> _filter;
-    size_t _filter_length;
-    float *_reversed_filter;
-	AdvancingBuffer<float> &_input_buffer;
-    AdvancingBuffer<float> &_output_buffer;
+    	for (unsigned j = 0; j != _interpolation_factor; ++j)
+    	    for (size_t k = j; k < _filter_length; k += _interpolation_factor)
+    	        *q++ = _reversed_filter[k];
+
+    	return subfilters;
+
+    }
 
-    // The number of input samples required to produce each record
-	// of _interpolation_factor consecutive output samples.
-    size_t _input_record_size;
 
     static float *_reverse(vector<float> &v) {
     	float *result = new float[v.size()];
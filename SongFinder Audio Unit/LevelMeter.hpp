@@ -0,0 +1,188 @@
+#ifndef LEVEL_METER
+#define LEVEL_METER
+
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+
+
+using std::size_t;
+
+
+// Time constants in seconds of the exponential smoothing a
+// `LevelMeter` applies to its readings as they rise (attack) and fall
+// (release). An attack time of zero makes a reading rise instantly.
+struct LevelMeterBallistics {
+    float peak_attack = 0;
+    float peak_release = .75;       // about 20 dB in 1.7 seconds
+    float rms_attack = .3;
+    float rms_release = .3;
+};
+
+
+// Per-block smoothing coefficients derived from `LevelMeterBallistics`
+// for a block duration. A smoothed value moves this fraction of the
+// way toward the block's value.
+struct LevelMeterCoefficients {
+
+    float peak_attack;
+    float peak_release;
+    float rms_attack;
+    float rms_release;
+
+    LevelMeterCoefficients(
+        const LevelMeterBallistics &ballistics, double block_duration) :
+        peak_attack(_get_coefficient(ballistics.peak_attack, block_duration)),
+        peak_release(_get_coefficient(ballistics.peak_release, block_duration)),
+        rms_attack(_get_coefficient(ballistics.rms_attack, block_duration)),
+        rms_release(_get_coefficient(ballistics.rms_release, block_duration))
+    { }
+
+private:
+
+    static float _get_coefficient(float time_constant, double block_duration) {
+        if (time_constant <= 0)
+            return 1;
+        else
+            return static_cast<float>(1 - std::exp(-block_duration / time_constant));
+    }
+
+};
+
+
+// Peak and RMS level meter for one audio channel.
+//
+// The render thread calls `process` once per block, which measures
+// the block's peak magnitude and mean power in one pass, smooths them,
+// and publishes them together in a single lock-free atomic, so a
+// reader never sees a peak from one block and a power from another.
+// The conversion to decibels is left to the readers, so the render
+// thread computes no logarithms. Meters are aligned to cache lines, so
+// that meters for different channels stored in an array do not share
+// one, and publishing to one does not slow reading another.
+
+
+class alignas(64) LevelMeter {
+
+
+public:
+
+
+    // Reading for silence, in dBFS.
+    static constexpr float silence_level = -200;
+
+
+    LevelMeter() :
+        _peak(0),
+        _power(0),
+        _reading({ 0, 0 })
+    { }
+
+
+    LevelMeter(const LevelMeter &) = delete;
+    LevelMeter &operator=(const LevelMeter &) = delete;
+
+
+    // Resets the meter to silence. Call only when the render thread
+    // is not running.
+    void reset() {
+        _peak = 0;
+        _power = 0;
+        _reading.store({ 0, 0 }, std::memory_order_relaxed);
+    }
+
+
+    // Measures `count` samples `stride` floats apart and publishes the
+    // updated readings. Call only from the render thread.
+    void process(
+        const float *samples, size_t count,
+        const LevelMeterCoefficients &coefficients, size_t stride = 1) {
+
+        if (count == 0)
+            return;
+
+        float peak = 0;
+        float sum = 0;
+        for (size_t i = 0; i != count; ++i) {
+            const float sample = samples[i * stride];
+            const float magnitude = std::fabs(sample);
+            peak = magnitude > peak ? magnitude : peak;
+            sum += sample * sample;
+        }
+
+        update(peak, sum / count, coefficients);
+
+    }
+
+
+    // Smooths the peak magnitude and mean power of a block that the
+    // caller has already measured, and publishes the updated readings.
+    // Call only from the render thread.
+    void update(
+        float block_peak, float block_power,
+        const LevelMeterCoefficients &coefficients) {
+
+        const float peak_coefficient = block_peak > _peak ?
+            coefficients.peak_attack : coefficients.peak_release;
+        _peak += peak_coefficient * (block_peak - _peak);
+
+        const float power_coefficient = block_power > _power ?
+            coefficients.rms_attack : coefficients.rms_release;
+        _power += power_coefficient * (block_power - _power);
+
+        // Flush tiny values rather than letting release make them
+        // denormal, which is slow on some processors.
+        if (_peak < 1e-10f)
+            _peak = 0;
+        if (_power < 1e-20f)
+            _power = 0;
+
+        _reading.store({ _peak, _power }, std::memory_order_relaxed);
+
+    }
+
+
+    // Returns the smoothed peak level in dBFS, where full scale is a
+    // magnitude of one. Callable from any thread.
+    float peak_level() const {
+        return _to_decibels(_reading.load(std::memory_order_relaxed).peak, 20);
+    }
+
+
+    // Returns the smoothed RMS level in dBFS. Callable from any thread.
+    float rms_level() const {
+        return _to_decibels(_reading.load(std::memory_order_relaxed).power, 10);
+    }
+
+
+private:
+
+
+    struct Reading {
+        float peak;
+        float power;
+    };
+
+    static_assert(std::atomic<Reading>::is_always_lock_free);
+
+    // Smoothed values, used only by the render thread.
+    float _peak;
+    float _power;
+
+    // Published values.
+    std::atomic<Reading> _reading;
+
+
+    static float _to_decibels(float value, float scale) {
+        if (value > 0)
+            return std::fmax(scale * std::log10(value), silence_level);
+        else
+            return silence_level;
+    }
+
+
+};
+
+
+#endif
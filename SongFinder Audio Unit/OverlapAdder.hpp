@@ -5,11 +5,22 @@
 #include <cmath>
 #include <cstring>
 #include <numbers>
+#include <string>
+#include <vector>
 #include "AdvancingBuffer.hpp"
 
 
 using std::size_t;
 using std::string;
+using std::vector;
+
+
+// Overlap-adder of one or more channels of audio.
+//
+// An overlap-adder of more than one channel reads and writes
+// interleaved frames, and loads each window coefficient once for all
+// of the channels of a frame. Each channel is processed exactly as by
+// a one-channel overlap-adder.
 
 
 class OverlapAdder {
@@ -25,7 +36,8 @@ public:
 		double window_duration,
 		double sample_rate,
 		AdvancingBuffer<float> &input_buffer,
-		AdvancingBuffer<float> &output_buffer
+		AdvancingBuffer<float> &output_buffer,
+		unsigned channel_count = 1
 
 	) :
 
@@ -34,18 +46,18 @@ public:
 		_window_duration(window_duration),
 		_sample_rate(sample_rate),
 	    _input_buffer(input_buffer),
-		_output_buffer(output_buffer)
+		_output_buffer(output_buffer),
+		_channel_count(channel_count)
 	
 	{
 
-    	const double segment_duration = _window_duration / _decimation_factor;
-    	_segment_size =
-		    static_cast<size_t>(round(segment_duration * _sample_rate));
+    	_segment_size = get_segment_size(
+		    _decimation_factor, _window_duration, _sample_rate);
     	_window_size = _decimation_factor * _segment_size;
     	_window = _create_window(_window_type);
 
     	const size_t accumulator_size =
-		    (_decimation_factor - 1) * _segment_size;
+		    (_decimation_factor - 1) * _segment_size * _channel_count;
     	_accumulator = new float[accumulator_size]();
     	_accumulator_end = _accumulator + accumulator_size;
     	_accumulator_ptr = _accumulator;
@@ -53,34 +65,145 @@ public:
     }
 
 
+    ~OverlapAdder() {
+        delete[] _window;
+        delete[] _accumulator;
+    }
+
+
+    OverlapAdder(const OverlapAdder &) = delete;
+    OverlapAdder &operator=(const OverlapAdder &) = delete;
+
+
+    // Returns the window segment size of an overlap-adder, i.e. the
+    // number of frames it outputs for each window of input.
+    static size_t get_segment_size(
+        unsigned decimation_factor, double window_duration,
+        double sample_rate) {
+
+    	const double segment_duration = window_duration / decimation_factor;
+    	return static_cast<size_t>(round(segment_duration * sample_rate));
+
+    }
+
+
     string window_type() {
 		return _window_type;
 	}
 
 
+	size_t window_size() {
+		return _window_size;
+	}
+
+
+	unsigned channel_count() {
+		return _channel_count;
+	}
+
+
 	vector<float> window() {
         const vector<float> window(_window, _window + _window_size);
 		return window;
 	}
 
 
+	// Returns the number of bytes of memory allocated by this
+	// overlap-adder, not including its input and output buffers.
+	size_t memory_size() {
+		const size_t accumulator_size = _accumulator_end - _accumulator;
+		return sizeof(*this) + _window_type.capacity() +
+		    (_window_size + accumulator_size) * sizeof(float);
+	}
+
+
+    // Zeroes the overlapping window segments accumulated so far, as
+    // when the overlap-adder was created. This does not allocate, so
+    // it can be called on the render thread.
+    void reset() {
+        const size_t accumulator_size = _accumulator_end - _accumulator;
+        std::memset(_accumulator, 0, accumulator_size * sizeof(float));
+        _accumulator_ptr = _accumulator;
+    }
+
+
+    // Returns the number of floats of state that `save_state` writes,
+    // which is the size of the accumulator.
+    size_t state_size() {
+        return _accumulator_end - _accumulator;
+    }
+
+
+    // Writes the overlapping window segments accumulated so far to
+    // `state`, oldest first.
+    void save_state(float *state) {
+        const size_t tail_size = _accumulator_end - _accumulator_ptr;
+        const size_t head_size = _accumulator_ptr - _accumulator;
+        std::memcpy(state, _accumulator_ptr, tail_size * sizeof(float));
+        std::memcpy(state + tail_size, _accumulator, head_size * sizeof(float));
+    }
+
+
+    // Restores overlapping window segments written by `save_state`
+    // of an overlap-adder with the same configuration. This does not
+    // allocate, so it can be called on the render thread.
+    void restore_state(const float *state) {
+        std::memcpy(_accumulator, state, state_size() * sizeof(float));
+        _accumulator_ptr = _accumulator;
+    }
+
+
     void process() {
+        if (_channel_count == 2)
+            _process<2>();
+        else
+            _process<1>();
+    }
+
+
+private:
 
-    	const size_t window_count = _input_buffer.size() / _window_size;
+
+    unsigned _decimation_factor;
+	string _window_type;
+    double _window_duration;
+    double _sample_rate;
+    AdvancingBuffer<float> &_input_buffer;
+    AdvancingBuffer<float> &_output_buffer;
+    unsigned _channel_count;
+
+    size_t _window_size;
+    size_t _segment_size;    // window segment size
+    float *_window;
+    float *_accumulator;
+    float *_accumulator_end;
+    float *_accumulator_ptr;
+
+
+    // Processes all complete windows of `C`-channel input. The loops
+    // over channels have constant trip counts, so the compiler unrolls
+    // them.
+    template <size_t C>
+    void _process() {
+
+    	const size_t window_count = _input_buffer.size() / (C * _window_size);
     	const size_t internal_segment_count = _decimation_factor - 2;
 
     	const float *x = _input_buffer.data();
     	float *a = _accumulator_ptr;
 
-    	float *y = _output_buffer.extend(window_count * _segment_size);
+    	float *y = _output_buffer.extend(window_count * _segment_size * C);
 
     	for (size_t i = 0; i != window_count; ++i) {
 
     		const float *w = _window;
 
     		// Process initial window segment, generating output.
-			for (size_t j = 0; j != _segment_size; ++j)
-				*y++ = *a++ + *w++ * *x++;
+			for (size_t j = 0; j != _segment_size; ++j) {
+			    const float c = *w++;
+			    for (size_t l = 0; l != C; ++l)
+				    *y++ = *a++ + c * *x++;
+			}
 
 			// Wrap around to beginning of accumulator if needed.
 			if (a == _accumulator_end)
@@ -92,8 +215,11 @@ public:
 
 				// Apply internal window segment to next input segment
 				// and accumulate.
-				for (size_t j = 0; j != _segment_size; ++j)
-					*a++ += *w++ * *x++;
+				for (size_t j = 0; j != _segment_size; ++j) {
+				    const float c = *w++;
+				    for (size_t l = 0; l != C; ++l)
+					    *a++ += c * *x++;
+				}
 
 				// Wrap around to beginning of accumulator if needed.
 				if (a == _accumulator_end)
@@ -102,8 +228,11 @@ public:
 			}
 
 			// Process final window segment, writing results to accumulator.
-			for (size_t j = 0; j != _segment_size; ++j)
-				*a++ = *w++ * *x++;
+			for (size_t j = 0; j != _segment_size; ++j) {
+			    const float c = *w++;
+			    for (size_t l = 0; l != C; ++l)
+				    *a++ = c * *x++;
+			}
 
 			// Wrap around to beginning of accumulator if needed.
 			if (a == _accumulator_end)
@@ -115,29 +244,11 @@ public:
     	_accumulator_ptr = a;
         
 		// Discard processed inputs.
-        _input_buffer.discard(window_count * _window_size);
+        _input_buffer.discard(window_count * _window_size * C);
 
     }
 
 
-private:
-
-
-    unsigned _decimation_factor;
-	string _window_type;
-    double _window_duration;
-    double _sample_rate;
-    AdvancingBuffer<float> &_input_buffer;
-    AdvancingBuffer<float> &_output_buffer;
-
-    size_t _window_size;
-    size_t _segment_size;    // window segment size
-    float *_window;
-    float *_accumulator;
-    float *_accumulator_end;
-    float *_accumulator_ptr;
-
-
     float *_create_window(string window_type) {
 
 		if (window_type == "SongFinder")
@@ -0,0 +1,107 @@
+#ifndef PARAMETER_QUEUE
+#define PARAMETER_QUEUE
+
+
+#include <AudioToolbox/AudioToolbox.h>
+#include <atomic>
+
+
+using std::size_t;
+
+
+struct ParameterMessage {
+    AUParameterAddress address;
+    AUValue value;
+};
+
+
+// Wait-free, single-producer, single-consumer queue of parameter
+// messages.
+//
+// A `SongFinderDSPKernel` uses one of these to pass parameter changes
+// from the thread that sets its parameters to the audio render thread,
+// and another to pass parameter changes received by the render thread
+// to the thread that builds processors. Neither `push` nor `drain`
+// locks, allocates, or performs I/O. If the queue is full, `push`
+// fails, and the producer must arrange some other way for the
+// consumer to get the value, e.g. by having it resynchronize.
+
+
+class ParameterQueue {
+
+
+public:
+
+
+    ParameterQueue() :
+        _write_index(0),
+        _read_index(0)
+    { }
+
+
+    ParameterQueue(const ParameterQueue &) = delete;
+    ParameterQueue &operator=(const ParameterQueue &) = delete;
+
+
+    // Appends a message to the queue. Call only from the producer
+    // thread. Returns `false` if the queue was full, in which case the
+    // message is not appended.
+    bool push(AUParameterAddress address, AUValue value) {
+
+        const size_t write_index =
+            _write_index.load(std::memory_order_relaxed);
+        const size_t read_index =
+            _read_index.load(std::memory_order_acquire);
+
+        if (write_index - read_index == _capacity)
+            return false;
+
+        _messages[write_index & _index_mask] = { address, value };
+        _write_index.store(write_index + 1, std::memory_order_release);
+
+        return true;
+
+    }
+
+
+    // Calls `handler` for each message in the queue, oldest first, and
+    // removes the messages from the queue. Call only from the consumer
+    // thread. Returns the number of messages handled.
+    template <class Handler>
+    size_t drain(Handler handler) {
+
+        const size_t start_index = _read_index.load(std::memory_order_relaxed);
+        const size_t write_index =
+            _write_index.load(std::memory_order_acquire);
+
+        for (size_t i = start_index; i != write_index; ++i)
+            handler(_messages[i & _index_mask]);
+
+        _read_index.store(write_index, std::memory_order_release);
+
+        return write_index - start_index;
+
+    }
+
+
+private:
+
+
+    // Queue capacity, which must be a power of two. Parameters change
+    // at UI rates, so this is far more than enough for the messages
+    // that accumulate between render cycles.
+    static const size_t _capacity = 128;
+    static const size_t _index_mask = _capacity - 1;
+
+    ParameterMessage _messages[_capacity];
+
+    // Free-running message indices. The queue holds the messages with
+    // indices in [_read_index, _write_index).
+    std::atomic<size_t> _write_index;
+    std::atomic<size_t> _read_index;
+
+
+};
+
+
+#endif
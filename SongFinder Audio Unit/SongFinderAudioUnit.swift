@@ -156,6 +156,15 @@ public class SongFinderAudioUnit: AUAudioUnit {
         // Initialize superclass.
         try super.init(componentDescription: componentDescription, options: options)
 
+        // Tell hosts to re-read `latency` when processing parameter
+        // changes change it while rendering.
+        kernelAdapter.latencyObserver = { [weak self] in
+            DispatchQueue.main.async {
+                self?.willChangeValue(forKey: "latency")
+                self?.didChangeValue(forKey: "latency")
+            }
+        }
+
         // Show process and component description info.
         // showInfo(componentDescription)
         
@@ -200,17 +209,49 @@ public class SongFinderAudioUnit: AUAudioUnit {
         }
         
     }
+    
+    
+    // The smallest number of frames into which the render block splits
+    // a render cycle at events that need sample accuracy, except at the
+    // end of the cycle. Like `maximumFramesToRender`, this can only be
+    // set while render resources are not allocated.
+    public var minimumSegmentSize: AUAudioFrameCount {
+        
+        get {
+            return kernelAdapter.minimumSegmentSize
+        }
+        
+        set {
+            if !renderResourcesAllocated {
+                kernelAdapter.minimumSegmentSize = newValue
+            }
+        }
+        
+    }
 
     
     public override func allocateRenderResources() throws {
+        
+        // The kernel processes at the output sample rate, which may be
+        // any rate, but it does not convert between rates.
+        if kernelAdapter.inputBus.format.sampleRate != kernelAdapter.outputBus.format.sampleRate {
+            throw NSError(domain: NSOSStatusErrorDomain, code: Int(kAudioUnitErr_FormatNotSupported))
+        }
+        
+        willChangeValue(forKey: "latency")
+        defer { didChangeValue(forKey: "latency") }
+        
         try super.allocateRenderResources()
         kernelAdapter.allocateRenderResources()
+        
     }
 
     
     public override func deallocateRenderResources() {
+        willChangeValue(forKey: "latency")
         super.deallocateRenderResources()
         kernelAdapter.deallocateRenderResources()
+        didChangeValue(forKey: "latency")
     }
 
     
@@ -219,6 +260,184 @@ public class SongFinderAudioUnit: AUAudioUnit {
     }
 
     
+    // The delay in seconds that this AU adds to the audio passing
+    // through it, so hosts can compensate for it. This depends on the
+    // processing parameters and is zero when render resources are not
+    // allocated. It is key-value observable, and changes to it while
+    // rendering are reported on the main queue.
+    public override var latency: TimeInterval {
+        return kernelAdapter.latency
+    }
+
+    
+    // Number of filter multiply-adds per second performed by the
+    // processors, a platform-independent measure of the CPU cost of
+    // the current configuration. This is zero when render resources
+    // are not allocated.
+    public var processingCost: Double {
+        return kernelAdapter.processingCost
+    }
+
+    
+    // Size in frames of the blocks in which the processors run, or zero
+    // to run them on blocks as the host provides them. Larger blocks
+    // use less CPU at small host block sizes at the cost of
+    // `processingBlockSize - 1` frames of additional latency, which is
+    // included in `latency`. This can be changed while rendering.
+    public var processingBlockSize: AUAudioFrameCount {
+        get { kernelAdapter.processingBlockSize }
+        set { kernelAdapter.processingBlockSize = newValue }
+    }
+    
+    
+    // Whether the processors idle while their input has no energy
+    // above the cutoff, which saves most of the processing cost when
+    // there are no birds singing, and the band power in dBFS above
+    // which they resume. These can be changed while rendering.
+    public var activityGate: Bool {
+        get { kernelAdapter.activityGate }
+        set { kernelAdapter.activityGate = newValue }
+    }
+    
+    public var activityGateThreshold: Float {
+        get { kernelAdapter.activityGateThreshold }
+        set { kernelAdapter.activityGateThreshold = newValue }
+    }
+    
+    
+    // Fraction of the channel frames rendered since render resources
+    // were allocated that the processors rendered while idle.
+    public var idleFraction: Double {
+        let rendered = kernelAdapter.renderedFrameCount
+        return rendered == 0 ? 0 : Double(kernelAdapter.idleFrameCount) / Double(rendered)
+    }
+    
+    
+    // Whether the processors run on a dedicated worker thread rather
+    // than the render thread, and the latency in frames this adds,
+    // which is included in `latency`. This frees the render thread of
+    // nearly all processing cost, so heavier configurations can run at
+    // small buffer sizes. The latency should be at least twice the
+    // buffer size. These take effect when render resources are next
+    // allocated.
+    public var asyncRendering: Bool {
+        get { kernelAdapter.asyncRendering }
+        set { kernelAdapter.asyncRendering = newValue }
+    }
+    
+    public var asyncRenderingLatency: AUAudioFrameCount {
+        get { kernelAdapter.asyncRenderingLatency }
+        set { kernelAdapter.asyncRenderingLatency = newValue }
+    }
+    
+    // Number of frames passed through unprocessed since render
+    // resources were allocated because the worker thread fell behind.
+    public var asyncUnderrunFrameCount: UInt64 {
+        return kernelAdapter.asyncUnderrunFrameCount
+    }
+    
+    
+    // Whether the audio unit computes spectra of the input and output
+    // of its first output channel for display, and how many per
+    // second. Computing spectra costs the render thread only a copy
+    // of the audio, and costs nothing when disabled.
+    public var spectrumEnabled: Bool {
+        get { kernelAdapter.spectrumEnabled }
+        set { kernelAdapter.spectrumEnabled = newValue }
+    }
+    
+    public var spectrumFrameRate: Double {
+        get { kernelAdapter.spectrumFrameRate }
+        set { kernelAdapter.spectrumFrameRate = newValue }
+    }
+    
+    // Frequency in hertz between spectrum bins, the first of which is
+    // at zero hertz.
+    public var spectrumBinWidth: Double { kernelAdapter.spectrumBinWidth }
+    
+    
+    // Returns the latest input and output spectra in dBFS, and their
+    // frame number, which increases with each new pair of spectra and
+    // is zero if none have been computed. This never waits for the
+    // render thread. Call from only one thread, e.g. the main thread.
+    public func latestSpectra() -> (input: [Float], output: [Float], frameNumber: UInt64) {
+        let binCount = Int(kernelAdapter.spectrumBinCount)
+        var input = [Float](repeating: 0, count: binCount)
+        var output = [Float](repeating: 0, count: binCount)
+        let frameNumber = kernelAdapter.readSpectraInput(&input, output: &output)
+        return (input, output, frameNumber)
+    }
+    
+    
+    // Smoothed peak and RMS output levels of a channel in dBFS, where
+    // full scale is one. These never wait for the render thread. The
+    // `outputLevel0` and `outputLevel1` parameters are RMS levels.
+    public func outputPeakLevel(channel: Int) -> Float {
+        return kernelAdapter.outputPeakLevel(forChannel: channel)
+    }
+    
+    public func outputRmsLevel(channel: Int) -> Float {
+        return kernelAdapter.outputRmsLevel(forChannel: channel)
+    }
+    
+    
+    // Time constants in seconds of the smoothing of the output level
+    // meters' readings as they rise (attack) and fall (release).
+    public var meterPeakAttack: TimeInterval {
+        get { kernelAdapter.meterPeakAttack }
+        set { kernelAdapter.meterPeakAttack = newValue }
+    }
+    
+    public var meterPeakRelease: TimeInterval {
+        get { kernelAdapter.meterPeakRelease }
+        set { kernelAdapter.meterPeakRelease = newValue }
+    }
+    
+    public var meterRmsAttack: TimeInterval {
+        get { kernelAdapter.meterRmsAttack }
+        set { kernelAdapter.meterRmsAttack = newValue }
+    }
+    
+    public var meterRmsRelease: TimeInterval {
+        get { kernelAdapter.meterRmsRelease }
+        set { kernelAdapter.meterRmsRelease = newValue }
+    }
+    
+    
+    // Duration in seconds and shape of the ramps that smooth gain and
+    // balance changes. Ramps are exponential, i.e. linear in decibels,
+    // unless `linearGainRamps` is true.
+    public var gainRampDuration: TimeInterval {
+        get { kernelAdapter.gainRampDuration }
+        set { kernelAdapter.gainRampDuration = newValue }
+    }
+    
+    public var linearGainRamps: Bool {
+        get { kernelAdapter.linearGainRamps }
+        set { kernelAdapter.linearGainRamps = newValue }
+    }
+
+    
+    // Counts of diagnostic events reported by the render thread.
+    public var zeroFillCount: UInt64 { kernelAdapter.zeroFillCount }
+    public var oversizeBlockCount: UInt64 { kernelAdapter.oversizeBlockCount }
+    public var bufferOverflowCount: UInt64 { kernelAdapter.bufferOverflowCount }
+    public var bufferUnderflowCount: UInt64 { kernelAdapter.bufferUnderflowCount }
+
+    
+    // Largest processor buffer occupancy so far, in percent of capacity.
+    public var bufferHighWaterMark: Int { Int(kernelAdapter.bufferHighWaterMark) }
+
+    
+    // Returns messages describing the diagnostic events reported by the
+    // render thread since the last call. The render thread reports
+    // events through a lock-free ring rather than printing them, since
+    // printing can block. Call this from only one thread.
+    public func drainDiagnosticMessages() -> [String] {
+        return kernelAdapter.drainDiagnosticMessages()
+    }
+
+    
     // Boolean indicating that this AU can process the input audio in-place
     // in the input buffer, without requiring a separate output buffer.
     public override var canProcessInPlace: Bool {
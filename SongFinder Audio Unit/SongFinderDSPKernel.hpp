@@ -14,23 +14,137 @@
 #define SongFinderDSPKernel_hpp
 
 
+#import <atomic>
+#import <chrono>
 #import <cmath>
+#import <cstring>
+#import <functional>
+#import <iostream>
+#import <mutex>
 #import <string>
+#import <thread>
+#import <vector>
+#if defined(__APPLE__)
+#import <pthread.h>
+#endif
 #import "DSPKernel.hpp"
+#import "DenormalGuard.hpp"
+#import "GainRamp.hpp"
+#import "LevelMeter.hpp"
+#import "ParameterQueue.hpp"
 #import "SongFinderProcessor.hpp"
+#import "SongFinderProcessorSet.hpp"
+#import "SongFinderTuner.hpp"
+#import "SpectrumAnalyzer.hpp"
+#import "TapRing.hpp"
 
 
 using std::string;
 
 
 enum {
-    Cutoff, PitchShift, WindowType, WindowSize, Gain, Balance, OutputLevel0, OutputLevel1
+    Cutoff, PitchShift, WindowType, WindowSize, Gain, Balance, OutputLevel0, OutputLevel1,
+    Quality
 };
 
 
 const AUValue _LOW_OUTPUT_LEVEL = -200;    // dB
 
 
+// Changing the cutoff, pitch shift, window type, or window size of a
+// running kernel requires new processors. The kernel builds them on a
+// background builder thread and publishes them to the render thread
+// via an atomic pointer. The render thread crossfades from the old
+// processors to the new ones over `_CROSSFADE_DURATION` and then
+// hands the old processors back, again via an atomic pointer, to the
+// builder thread, which deletes them.
+//
+// New processors output the silence they were primed with before any
+// processed input, so the render thread runs them alongside the old
+// ones, still outputting the old ones' output, until they have warmed
+// up (see `SongFinderProcessor::warm_up_size`), and only then starts
+// the crossfade. When the old and new processors have different
+// latencies, as when the pitch shift factor changes, the crossfade is
+// thus from one delay of the input to the other, with no silence
+// between them. Processors reset when bypass ends warm up the same
+// way, with the render thread holding the bypassed input until they
+// have. The kernel reports the latency of new processors only once
+// the crossfade to them is complete, when the render thread publishes
+// it and the builder thread tells the latency observer. The render
+// thread never waits for the builder thread, and never allocates or
+// frees memory.
+//
+// The builder thread sleeps until it has something to do. Other
+// threads wake it by incrementing `_builderSignal` and notifying
+// waiters on it, which does not block, so the render thread can do
+// it too, when it queues a processor parameter event from the host or
+// hands back old processors.
+const double _CROSSFADE_DURATION = .02;    // seconds
+
+
+// Bypassing the kernel suspends its processors, so that it does no
+// processing at all and just copies its input to its output, or does
+// nothing when processing in place. The render thread fades from the
+// processed output to the input over `_CROSSFADE_DURATION` before
+// suspending the processors. When bypass ends, it resets the
+// processors, so that they start over from the primed state in which
+// they were created rather than outputting stale audio from before the
+// bypass, and fades from the input back to their output.
+
+
+// A kernel can optionally render asynchronously, running its
+// processors on a dedicated worker thread rather than on the render
+// thread. The render thread then only copies each block of input into
+// one `TapRing` and a block of processed output, `_asyncLatency` frames
+// older, out of another, so that its cost no longer depends on that of
+// the processors, at the price of that much added latency. The worker
+// thread takes new processors, crossfades to them, and resets them
+// after bypass in place of the render thread. If the worker falls
+// behind, so that output frames are not ready when the render thread
+// needs them, the render thread passes the input through in their
+// place and discards the late frames when they arrive. The render
+// thread never waits for the worker.
+//
+// The mode and the added latency take effect when render resources are
+// next allocated. The latency should be at least twice the host's
+// buffer size, to absorb the jitter of the worker's scheduling.
+const size_t _ASYNC_RING_CAPACITY = 16384;                  // frames, a power of two
+const AUAudioFrameCount _DEFAULT_ASYNC_LATENCY = 1024;      // frames
+const AUAudioFrameCount _MAX_ASYNC_LATENCY = _ASYNC_RING_CAPACITY / 2;
+
+
+// Gain and balance changes, on the other hand, are applied by the
+// render thread itself. The thread that sets parameters sends them to
+// the render thread through a wait-free queue, which the render thread
+// drains at the start of each call to `process`. Changes scheduled by
+// the host arrive on the render thread via `handleUnsplitEvent`.
+//
+// Parameter events do not split rendering into separate `process`
+// calls (see `DSPKernel::splitsRendering`). Instead, the kernel queues
+// gain and balance events in `handleUnsplitEvent` and applies them at
+// their offsets in the gain loop, which is cheap to split, rather than
+// splitting the processor calls, which have per-call overhead. It
+// passes processor parameter events on to `handleParameterEvent`,
+// which sends them to the builder thread through another queue.
+//
+// Gain and balance events closer together than
+// `_GAIN_EVENT_COALESCING_SIZE` are applied together, so that a dense
+// run of events starts no more ramps than one event per that many
+// frames.
+const int _MAX_GAIN_EVENTS = 64;
+const AUAudioFrameCount _GAIN_EVENT_COALESCING_SIZE = 32;   // frames
+const AUAudioFrameCount _DEFAULT_MIN_SEGMENT_SIZE = 32;
+
+
+// Output levels are metered by `LevelMeter`s, which the render thread
+// updates once per `process` call and which other threads read at any
+// time. The meters are not allocated with other render resources, so
+// that a reader never sees them freed, and so there is a fixed
+// maximum number of metered channels. Levels of further channels read
+// as `_LOW_OUTPUT_LEVEL`.
+const int _MAX_METERED_CHANNELS = 8;
+
+
 class SongFinderDSPKernel : public DSPKernel {
     
     
@@ -40,50 +154,643 @@ public:
     // MARK: Member Functions
 
     
-    SongFinderDSPKernel() {}
+    SongFinderDSPKernel() {
+        setMinimumSegmentSize(_DEFAULT_MIN_SEGMENT_SIZE);
+    }
+    
+    
+    ~SongFinderDSPKernel() {
+        if (_renderResourcesAllocated)
+            deallocateRenderResources();
+    }
 
     
-    void allocateRenderResources(int inputChannelCount, int outputChannelCount) {
+    // Sets the path of the file in which the kernel's tuner caches
+    // the fastest processor stage implementations for this machine.
+    void setTuningProfilePath(const string &path) {
+        _tuner.set_profile_path(path);
+    }
+    
+    
+    // Sets a function that the kernel calls when the value returned by
+    // `latencyFrames` changes while render resources are allocated, so
+    // that hosts can be told to compensate for the new latency. The
+    // function is called on the builder thread, never on the render
+    // thread. Set this only while render resources are not allocated.
+    void setLatencyObserver(std::function<void()> observer) {
+        _latencyObserver = std::move(observer);
+    }
+
+    
+    void allocateRenderResources(
+        int inputChannelCount, int outputChannelCount, double sampleRate) {
         
         _inputChannelCount = inputChannelCount;
         _outputChannelCount = outputChannelCount;
+        _sampleRate = sampleRate;
         
-        _processors = new SongFinderProcessor*[_outputChannelCount];
-        for (int i = 0; i != _outputChannelCount; ++i)
-            _processors[i] = _createProcessor();
-            
         _channelMap = _createChannelMap();
+        _sourceOutputMap = _createSourceOutputMap();
+        
+        _processors = _createProcessorSet(_config);
+        _warmUpFrames.store(_processors->warmUpFrames(), std::memory_order_relaxed);
+        _latencyFrames.store(_processors->latencyFrames(), std::memory_order_relaxed);
+        _publishProcessorSetInfo(_processors);
         
-        _gainFactors = new float[_outputChannelCount];
+        // Resume where the last processors left off, if they had the
+        // same configuration.
+        if (!_savedProcessorState.empty()) {
+            _processors->restoreState(
+                _savedProcessorState.data(), _savedProcessorState.size());
+            _savedProcessorState.clear();
+        }
         
-        _outputLevels = new float[_outputChannelCount];
+        _renderedFrameCount.store(0, std::memory_order_relaxed);
+        _idleFrameCount.store(0, std::memory_order_relaxed);
         
-        // Not sure this is necessary, but it at least seems like good form for
-        // the output levels to start out at `_LOW_OUTPUT_LEVEL`.
-        for (int i = 0; i != _outputChannelCount; ++i)
-            _outputLevels[i] = _LOW_OUTPUT_LEVEL;
+        _crossfadeLength = static_cast<AUAudioFrameCount>(
+            round(_CROSSFADE_DURATION * _sampleRate));
+        _crossfadeBuffers =
+            _createChannelBuffers(_outputChannelCount, maximumFramesToRender());
+
+        _bypassBuffers =
+            _createChannelBuffers(_outputChannelCount, maximumFramesToRender());
+
+        _stagingBuffers =
+            _createChannelBuffers(_STAGING_CHANNEL_COUNT, maximumFramesToRender());
+
+        // New processors are primed, so if bypassed we can suspend
+        // them without fading.
+        _renderBypassed = _bypassed.load(std::memory_order_relaxed);
+        _bypassFadePosition = _crossfadeLength;
+        
+        _gainRamps = new GainRamp[_outputChannelCount];
+        
+        for (LevelMeter &meter : _outputMeters)
+            meter.reset();
         
         _renderResourcesAllocated = true;
         
-        _updateGainFactors();
+        // The render thread is not yet running, so we can safely act
+        // as the consumer of `_parameterMessages` here. We discard any
+        // messages left over from before, since the current values
+        // are in `_gain` and `_balance`.
+        _parameterMessages.drain([](const ParameterMessage &) {});
+        _renderGain = _gain.load(std::memory_order_relaxed);
+        _renderBalance = _balance.load(std::memory_order_relaxed);
+        _parameterResyncNeeded.store(false, std::memory_order_relaxed);
+        _gainEventCount = 0;
+        _gainEventsDropped = false;
+        
+        _updateGainTargets(0, GainRampShape::Linear);
+
+        _startBuilder();
+
+        _asyncRendering = _asyncRenderingEnabled.load(std::memory_order_relaxed);
+        _asyncLatency = _asyncRendering ?
+            _asyncRenderingLatency.load(std::memory_order_relaxed) : 0;
+        _addedLatencyFrames.store(_asyncLatency, std::memory_order_relaxed);
+        _asyncUnderrunFrameCount.store(0, std::memory_order_relaxed);
+
+        if (_asyncRendering)
+            _startAsyncWorker();
+
+    }
+
+
+    static float **_createChannelBuffers(int channelCount, size_t size) {
+        float **buffers = new float*[channelCount];
+        for (int i = 0; i != channelCount; ++i)
+            buffers[i] = new float[size];
+        return buffers;
+    }
+
+
+    static void _deleteChannelBuffers(float **&buffers, int channelCount) {
+        if (buffers != nullptr)
+            for (int i = 0; i != channelCount; ++i)
+                delete[] buffers[i];
+        delete[] buffers;
+        buffers = nullptr;
+    }
+    
+    
+    // Creates a processor set that processes each input channel that
+    // is assigned to an output channel. All of the processors of a set
+    // have the same configuration, so output channels assigned the same
+    // input channel share a processor channel.
+    SongFinderProcessorSet *_createProcessorSet(const SongFinderConfig &config) {
+        const int channelCount = std::min(_inputChannelCount, _outputChannelCount);
+        return new SongFinderProcessorSet(
+            channelCount, config, _sampleRate, _maxInputSize, _tuner,
+            &_diagnostics);
+    }
+    
+    
+    // Makes information about a processor set available to other
+    // threads. We publish this when a set is built rather than when
+    // the render thread starts using it, since that is when its memory
+    // is allocated. Its latency is published separately, when the
+    // render thread finishes crossfading to it (see
+    // `_retireOutgoingProcessors`), since only then does the output
+    // have that latency.
+    void _publishProcessorSetInfo(SongFinderProcessorSet *processors) {
+        _processorMemorySize.store(processors->memorySize(), std::memory_order_relaxed);
+        _processingCost.store(processors->multiplyAddsPerSecond(), std::memory_order_relaxed);
+    }
+    
+    
+    void _startBuilder() {
+        _notifiedLatencyFrames = _latencyFrames.load(std::memory_order_relaxed);
+        _builderStopping = false;
+        _rebuildRequested = false;
+        _builderThread = std::thread(&SongFinderDSPKernel::_runBuilder, this);
+    }
+    
+    
+    void _stopBuilder() {
+        
+        {
+            std::lock_guard<std::mutex> lock(_builderMutex);
+            _builderStopping = true;
+        }
+        
+        _signalBuilder();
+        
+        if (_builderThread.joinable())
+            _builderThread.join();
         
     }
     
     
-    SongFinderProcessor *_createProcessor() {
+    void _requestRebuild() {
         
-        const string windowType = _windowType == 0 ? "Hann" : "SongFinder";
-        const double windowSize = _windowSize / 1000;
+        // `_builderMutex` must be held by the caller.
         
-        SongFinderProcessor *p = new SongFinderProcessor(
-            _maxInputSize, _cutoff, _pitchShift, windowType, windowSize);
+        if (_renderResourcesAllocated) {
+            _rebuildRequested = true;
+            _signalBuilder();
+        }
         
-        const size_t zero_count =
-            static_cast<size_t>(round(windowSize * p->sample_rate));
+    }
+    
+    
+    // Wakes the builder thread. This does not block, so it can be
+    // called on the render thread.
+    void _signalBuilder() {
+        _builderSignal.fetch_add(1, std::memory_order_release);
+        _builderSignal.notify_one();
+    }
+    
+    
+    void _runBuilder() {
+        
+        std::unique_lock<std::mutex> lock(_builderMutex);
+        
+        while (!_builderStopping) {
+            
+            // Load the signal before checking for work, so that we
+            // cannot miss a notification sent after the check.
+            const uint32_t signal = _builderSignal.load(std::memory_order_acquire);
+            
+            delete _retiredProcessors.exchange(nullptr, std::memory_order_acquire);
+            
+            // Report any latency change published by the render thread
+            // when it finished a crossfade.
+            const AUAudioFrameCount latency =
+                _latencyFrames.load(std::memory_order_relaxed);
+            if (latency != _notifiedLatencyFrames) {
+                _notifiedLatencyFrames = latency;
+                if (_latencyObserver) {
+                    lock.unlock();
+                    _latencyObserver();
+                    lock.lock();
+                }
+            }
+            
+            // Apply processor parameter changes scheduled by the host.
+            if (_configMessages.drain([this](const ParameterMessage &message) {
+                    _setConfigValue(message.address, message.value);
+                }) != 0)
+                _rebuildRequested = true;
+            
+            if (_rebuildRequested) {
+                
+                _rebuildRequested = false;
+                const SongFinderConfig config = _config;
+                
+                // Build without holding the lock, so parameter changes
+                // are not held up.
+                lock.unlock();
+                SongFinderProcessorSet *processors = _createProcessorSet(config);
+                _publishProcessorSetInfo(processors);
+                
+                // If the render thread has not yet taken previously
+                // published processors, they are superseded, and we
+                // delete them.
+                delete _pendingProcessors.exchange(processors, std::memory_order_acq_rel);
+                
+                lock.lock();
+                
+            } else {
+                // nothing to do
+                
+                // Sleep until a rebuild is requested, the render thread
+                // queues a processor parameter event or retires
+                // processors, or the builder is asked to stop. Release
+                // the lock meanwhile, so parameter changes are not held
+                // up.
+                lock.unlock();
+                _builderSignal.wait(signal, std::memory_order_acquire);
+                lock.lock();
+                
+            }
+            
+        }
+        
+    }
+    
+    
+    // Called by the render thread, or by the worker thread when
+    // rendering asynchronously, at the start of each render cycle to
+    // take newly built processors, if any. We take new processors only
+    // when we are not already crossfading and the builder has deleted
+    // the last processors we retired, so there is always somewhere to
+    // put the processors we are crossfading from.
+    void _takePendingProcessors() {
+        
+        if (_outgoingProcessors != nullptr ||
+                _retiredProcessors.load(std::memory_order_acquire) != nullptr)
+            return;
+        
+        SongFinderProcessorSet *processors =
+            _pendingProcessors.exchange(nullptr, std::memory_order_acq_rel);
+        
+        if (processors != nullptr) {
+            _outgoingProcessors = _processors;
+            _processors = processors;
+            _crossfadePosition =
+                -static_cast<int64_t>(_processors->warmUpFrames());
+            _warmUpFrames.store(_processors->warmUpFrames(), std::memory_order_relaxed);
+        }
+        
+    }
+    
+    
+    // Called by the render thread, or by the worker thread when
+    // rendering asynchronously, at the end of each render cycle.
+    void _advanceCrossfade(AUAudioFrameCount frameCount) {
+        
+        if (_outgoingProcessors != nullptr) {
+            
+            _crossfadePosition += frameCount;
+            
+            if (_crossfadePosition >= _crossfadeLength)
+                _retireOutgoingProcessors();
+            
+        }
+        
+    }
+    
+    
+    // Hands the processors we were crossfading from back to the builder
+    // thread, which deletes them. The output is now entirely that of
+    // the new processors, so this publishes their latency, which the
+    // builder thread reports to the latency observer.
+    void _retireOutgoingProcessors() {
+        _latencyFrames.store(_processors->latencyFrames(), std::memory_order_relaxed);
+        _retiredProcessors.store(_outgoingProcessors, std::memory_order_release);
+        _outgoingProcessors = nullptr;
+        _signalBuilder();
+    }
+    
+    
+    // Crossfades linearly from `from` to `to`, whose samples are
+    // `stride` floats apart, writing the result to `to`, starting
+    // `_crossfadePosition` samples into the crossfade. Before the
+    // crossfade starts, i.e. at negative positions, while the incoming
+    // processors warm up, this copies `from` to `to`.
+    void _crossfade(
+        const float *from, float *to, AUAudioFrameCount frameCount,
+        size_t stride) {
+        
+        const float increment = 1.f / _crossfadeLength;
+        
+        for (AUAudioFrameCount k = 0; k != frameCount; ++k) {
+            
+            const int64_t position = _crossfadePosition + k;
+            
+            if (position >= _crossfadeLength)
+                break;
+            
+            if (position < 0)
+                to[k * stride] = from[k];
+            
+            else {
+                const float g = (position + 1) * increment;
+                to[k * stride] = from[k] + g * (to[k * stride] - from[k]);
+            }
+
+        }
+
+    }
+
+
+    // Called by the render thread to process the channels of processor
+    // `p`, crossfading from the outgoing processor if there is one.
+    //
+    // A processor of two channels reads both with one stride and writes
+    // both with one stride. If the two channels of the input or output
+    // buffers have different strides, as when one is interleaved with
+    // other channels and the other is not, the channels are staged
+    // through `_stagingBuffers`.
+    void _processChannels(
+        int p, AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) {
+
+        SongFinderProcessor *processor = _processors->processor(p);
+        const int firstChannel = _processors->firstChannel(p);
+        const unsigned channelCount = processor->channel_count();
+
+        const float *inputs[_STAGING_CHANNEL_COUNT] = { };
+        float *outputs[_STAGING_CHANNEL_COUNT] = { };
+        float *processorOutputs[_STAGING_CHANNEL_COUNT] = { };
+        size_t inputStrides[_STAGING_CHANNEL_COUNT];
+        size_t outputStrides[_STAGING_CHANNEL_COUNT];
+
+        for (unsigned l = 0; l != channelCount; ++l) {
+            inputs[l] = _channelData(
+                _inputBuffers, firstChannel + l, bufferOffset, inputStrides[l]);
+            outputs[l] = _channelData(
+                _outputBuffers, firstChannel + l, bufferOffset, outputStrides[l]);
+            processorOutputs[l] = outputs[l];
+        }
 
-        p->prime_input(zero_count);
+        size_t inputStride = inputStrides[0];
+        size_t outputStride = outputStrides[0];
+
+        const bool staged = channelCount == 2 &&
+            (inputStrides[0] != inputStrides[1] ||
+             outputStrides[0] != outputStrides[1]);
+
+        if (staged) {
+            for (unsigned l = 0; l != channelCount; ++l) {
+                float *stagedInputs = _stagingBuffers[l];
+                for (int k = 0; k != frameCount; ++k)
+                    stagedInputs[k] = inputs[l][k * inputStrides[l]];
+                inputs[l] = stagedInputs;
+                processorOutputs[l] = stagedInputs;
+            }
+            inputStride = 1;
+            outputStride = 1;
+        }
+
+        if (_outgoingProcessors != nullptr) {
+            // crossfading from outgoing processors
+
+            // Note that we must process with the outgoing processor
+            // first, since when processing in place the other processor
+            // overwrites the inputs.
+            float *const *outgoingOutputs = _crossfadeBuffers + firstChannel;
+            _outgoingProcessors->processor(p)->process(
+                inputs, frameCount, outgoingOutputs, inputStride, 1);
+            processor->process(
+                inputs, frameCount, processorOutputs, inputStride, outputStride);
+            for (unsigned l = 0; l != channelCount; ++l)
+                _crossfade(
+                    outgoingOutputs[l], processorOutputs[l], frameCount,
+                    outputStride);
+
+        } else {
+            // not crossfading
+
+            processor->process(
+                inputs, frameCount, processorOutputs, inputStride, outputStride);
+
+        }
+
+        if (staged)
+            for (unsigned l = 0; l != channelCount; ++l)
+                for (int k = 0; k != frameCount; ++k)
+                    outputs[l][k * outputStrides[l]] = processorOutputs[l][k];
+
+    }
+
+
+    void _startAsyncWorker() {
+
+        const int channelCount = _processors->channelCount();
+        const AUAudioFrameCount maxFrameCount = maximumFramesToRender();
+
+        _asyncChannelCount = channelCount;
+        _asyncChunkSize = std::min<AUAudioFrameCount>(_maxInputSize, maxFrameCount);
+
+        // The output ring is larger than the input ring so that it
+        // always has room for everything in flight, including frames
+        // that are stale or late and not yet discarded.
+        _asyncInputRing = new TapRing(channelCount, _ASYNC_RING_CAPACITY);
+        _asyncOutputRing = new TapRing(channelCount, 2 * _ASYNC_RING_CAPACITY);
+
+        _asyncInputs = _createChannelBuffers(channelCount, maxFrameCount);
+        _asyncOutputs = _createChannelBuffers(channelCount, maxFrameCount);
+        _workerInputs = _createChannelBuffers(channelCount, _asyncChunkSize);
+        _workerOutputs = _createChannelBuffers(channelCount, _asyncChunkSize);
+        _asyncReadPointers = new float*[channelCount];
+
+        // Start the output `_asyncLatency` frames behind the input.
+        for (int i = 0; i != channelCount; ++i)
+            std::fill(_workerOutputs[i], _workerOutputs[i] + _asyncChunkSize, 0.f);
+        for (AUAudioFrameCount n = 0; n < _asyncLatency; n += _asyncChunkSize)
+            _writeAsyncOutputs(std::min(_asyncChunkSize, _asyncLatency - n));
+
+        _asyncInFlightCount = _asyncLatency;
+        _asyncStaleCount = 0;
+        _asyncPushedCount = 0;
+        _asyncResetPosition.store(_NO_ASYNC_RESET, std::memory_order_relaxed);
+        _asyncSignal.store(0, std::memory_order_relaxed);
+        _asyncStopping.store(false, std::memory_order_relaxed);
+
+        _asyncWorker = std::thread(&SongFinderDSPKernel::_runAsyncWorker, this);
+
+    }
+
+
+    void _stopAsyncWorker() {
+
+        _asyncStopping.store(true, std::memory_order_relaxed);
+        _asyncSignal.fetch_add(1, std::memory_order_release);
+        _asyncSignal.notify_one();
+
+        if (_asyncWorker.joinable())
+            _asyncWorker.join();
+
+    }
+
+
+    void _runAsyncWorker() {
+
+        _raiseWorkerPriority();
+
+        const DenormalGuard denormalGuard;
+
+        // number of frames read from `_asyncInputRing`
+        uint64_t position = 0;
+
+        while (true) {
+
+            // Load the signal before checking for input, so that we
+            // cannot miss a notification sent after the check.
+            const uint32_t signal = _asyncSignal.load(std::memory_order_acquire);
+
+            if (_asyncStopping.load(std::memory_order_relaxed))
+                break;
+
+            const size_t available = _asyncInputRing->available();
+
+            // The render thread sets the reset position before it
+            // commits any input following it, so we see the position
+            // of any reset preceding the available input.
+            uint64_t resetPosition = _asyncResetPosition.load(std::memory_order_acquire);
+
+            if (resetPosition == position) {
+                _resetWorkerProcessors();
+                _asyncResetPosition.compare_exchange_strong(
+                    resetPosition, _NO_ASYNC_RESET, std::memory_order_relaxed);
+                continue;
+            }
+
+            if (available == 0) {
+                _asyncSignal.wait(signal, std::memory_order_acquire);
+                continue;
+            }
+
+            // Process at most one chunk, and stop at any reset position.
+            size_t count = std::min<size_t>(available, _asyncChunkSize);
+            if (resetPosition > position)
+                count = std::min<uint64_t>(count, resetPosition - position);
+
+            count = _asyncInputRing->read(_workerInputs, count);
+            _processWorkerChunk(static_cast<AUAudioFrameCount>(count));
+            position += count;
+
+        }
+
+    }
+
+
+    // Asks the scheduler to run the calling thread ahead of everything
+    // but real time threads, since the render thread needs its output
+    // within `_asyncLatency` frames.
+    static void _raiseWorkerPriority() {
+#if defined(__APPLE__)
+        pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+#endif
+    }
+
+
+    // Called by the worker thread to process a chunk of frames from
+    // `_workerInputs` and send them to the render thread. This does for
+    // the worker what `process` does for the render thread when not
+    // rendering asynchronously.
+    void _processWorkerChunk(AUAudioFrameCount frameCount) {
+
+        _takePendingProcessors();
+
+        uint64_t renderedFrameCount = _renderedFrameCount.load(std::memory_order_relaxed);
+        uint64_t idleFrameCount = _idleFrameCount.load(std::memory_order_relaxed);
+
+        for (int p = 0; p != _processors->processorCount(); ++p) {
+
+            SongFinderProcessor *processor = _processors->processor(p);
+            const int firstChannel = _processors->firstChannel(p);
+            const unsigned channelCount = processor->channel_count();
+            const float *const *inputs = _workerInputs + firstChannel;
+            float *const *outputs = _workerOutputs + firstChannel;
+
+            if (_outgoingProcessors != nullptr) {
+                // crossfading from outgoing processors
+
+                float *const *outgoingOutputs = _crossfadeBuffers + firstChannel;
+                _outgoingProcessors->processor(p)->process(
+                    inputs, frameCount, outgoingOutputs);
+                processor->process(inputs, frameCount, outputs);
+                for (unsigned l = 0; l != channelCount; ++l)
+                    _crossfade(outgoingOutputs[l], outputs[l], frameCount, 1);
+
+            } else {
+                // not crossfading
+
+                processor->process(inputs, frameCount, outputs);
+
+            }
+
+            renderedFrameCount += frameCount * channelCount;
+            if (processor->idle() || processor->silent())
+                idleFrameCount += frameCount * channelCount;
+
+        }
+
+        _renderedFrameCount.store(renderedFrameCount, std::memory_order_relaxed);
+        _idleFrameCount.store(idleFrameCount, std::memory_order_relaxed);
+
+        _advanceCrossfade(frameCount);
+
+        _writeAsyncOutputs(frameCount);
+
+    }
+
+
+    // Writes `frameCount` frames of `_workerOutputs` to the output
+    // ring. The ring has room for all frames in flight, so this does
+    // not drop them.
+    void _writeAsyncOutputs(size_t frameCount) {
+        if (_asyncOutputRing->reserve(frameCount)) {
+            for (int i = 0; i != _asyncChannelCount; ++i)
+                _asyncOutputRing->write(i, _workerOutputs[i], frameCount);
+            _asyncOutputRing->commit(frameCount);
+        }
+    }
+
+
+    // Called by the worker thread when it reaches the point in its
+    // input at which bypass ended. This resets the processors and stops
+    // any crossfade, as `_updateBypass` and `_advanceBypassFade` do
+    // when not rendering asynchronously.
+    void _resetWorkerProcessors() {
+
+        if (_outgoingProcessors != nullptr)
+            _retireOutgoingProcessors();
+
+        _processors->reset();
+
+    }
+
+    
+    // Returns a pointer to the sample of channel `channel` of frame
+    // `bufferOffset` of `buffers`, and sets `stride` to the number of
+    // floats between successive samples of the channel. The channels
+    // of the buffer list can be deinterleaved, with one per buffer, or
+    // interleaved, with several in one buffer, so the kernel can read
+    // and write interleaved audio in place without converting it.
+    static float *_channelData(
+        const AudioBufferList *buffers, int channel,
+        AUAudioFrameCount bufferOffset, size_t &stride) {
         
-        return p;
+        for (UInt32 i = 0; i != buffers->mNumberBuffers; ++i) {
+            
+            const AudioBuffer &buffer = buffers->mBuffers[i];
+            const int channelCount = buffer.mNumberChannels;
+            
+            if (channel < channelCount) {
+                stride = channelCount;
+                return (float *) buffer.mData + bufferOffset * stride + channel;
+            }
+            
+            channel -= channelCount;
+            
+        }
+        
+        stride = 1;
+        return nullptr;
         
     }
     
@@ -101,22 +808,49 @@ public:
     }
     
     
-    void _updateGainFactors() {
+    // Creates `_sourceOutputMap` from `_channelMap`. The first output
+    // channel assigned an input channel is processed, and the others
+    // assigned the same input channel copy its output.
+    int *_createSourceOutputMap() {
+        
+        int *sourceOutputMap = new int[_outputChannelCount];
+        
+        for (int i = 0; i != _outputChannelCount; ++i) {
+            sourceOutputMap[i] = -1;
+            for (int j = 0; j != i; ++j) {
+                if (_channelMap[j] == _channelMap[i]) {
+                    sourceOutputMap[i] = j;
+                    break;
+                }
+            }
+        }
+        
+        return sourceOutputMap;
+        
+    }
+    
+    
+    // Starts gain ramps for all channels to the gain factors indicated
+    // by `_renderGain` and `_renderBalance`.
+    void _updateGainTargets(size_t rampSize, GainRampShape shape) {
         
         if (_renderResourcesAllocated) {
             
-            // Set the gain factors of all channels according to `_gain`.
-            float gainFactor = _dbToFactor(_gain);
-            for (int i = 0; i != _outputChannelCount; ++i)
-                _gainFactors[i] = gainFactor;
-            
-            // If stereo, adjust gain factor of left or right channel if indicated by `_balance`.
-            if (_outputChannelCount == 2) {
-                if (_balance > 0) {
-                    _gainFactors[0] *= _dbToFactor(-_balance);
-                } else if (_balance < 0) {
-                    _gainFactors[1] *= _dbToFactor(_balance);
+            for (int i = 0; i != _outputChannelCount; ++i) {
+                
+                // Set the gain of all channels according to `_renderGain`.
+                float gain = _renderGain;
+                
+                // If stereo, adjust gain of left or right channel if indicated by `_renderBalance`.
+                if (_outputChannelCount == 2) {
+                    if (i == 0 && _renderBalance > 0)
+                        gain -= _renderBalance;
+                    else if (i == 1 && _renderBalance < 0)
+                        gain += _renderBalance;
                 }
+                
+                _gainRamps[i].set_target(_dbToFactor(gain), rampSize, shape);
+                
             }
             
         }
@@ -124,6 +858,16 @@ public:
     }
     
     
+    // Starts gain ramps for a gain or balance change that did not come
+    // with its own ramp duration.
+    void _smoothGainTargets() {
+        const double duration = _gainRampDuration.load(std::memory_order_relaxed);
+        const size_t rampSize = static_cast<size_t>(
+            round(duration * _sampleRate));
+        _updateGainTargets(rampSize, _gainRampShape.load(std::memory_order_relaxed));
+    }
+    
+    
     float _dbToFactor(float x) {
         return std::pow(10, x / 20);
     }
@@ -131,132 +875,621 @@ public:
     
     void deallocateRenderResources() {
         
-        for (int i = 0; i != _outputChannelCount; ++i)
-            delete _processors[i];
-        delete[] _processors;
+        _stopBuilder();
+
+        if (_asyncRendering)
+            _stopAsyncWorker();
+
+        // Save the state of the processors, so that if render resources
+        // are reallocated with the same configuration, as when the host
+        // stops and restarts rendering around an audio session
+        // interruption, the new processors resume where these left off
+        // rather than starting over from silence.
+        //
+        // Processors that bypass has suspended hold stale audio from
+        // before the bypass, and processors still warming up after a
+        // reset or a configuration change have not yet been faded to,
+        // so resuming either would play their output with no reset or
+        // fade. In those cases we discard any saved state instead, so
+        // the new processors start over from their primed state.
+        const bool resumable =
+            !_processorsSuspended() && _bypassFadePosition >= 0 &&
+            (_outgoingProcessors == nullptr || _crossfadePosition >= 0);
+        if (resumable) {
+            _savedProcessorState.resize(_processors->stateSize());
+            _processors->saveState(_savedProcessorState.data());
+        } else {
+            _savedProcessorState.clear();
+        }
+        
+        delete _processors;
         _processors = nullptr;
         
+        delete _outgoingProcessors;
+        _outgoingProcessors = nullptr;
+        
+        delete _pendingProcessors.exchange(nullptr);
+        delete _retiredProcessors.exchange(nullptr);
+        
+        _deleteChannelBuffers(_crossfadeBuffers, _outputChannelCount);
+        _deleteChannelBuffers(_bypassBuffers, _outputChannelCount);
+        _deleteChannelBuffers(_stagingBuffers, _STAGING_CHANNEL_COUNT);
+
+        delete _asyncInputRing;
+        _asyncInputRing = nullptr;
+
+        delete _asyncOutputRing;
+        _asyncOutputRing = nullptr;
+
+        _deleteChannelBuffers(_asyncInputs, _asyncChannelCount);
+        _deleteChannelBuffers(_asyncOutputs, _asyncChannelCount);
+        _deleteChannelBuffers(_workerInputs, _asyncChannelCount);
+        _deleteChannelBuffers(_workerOutputs, _asyncChannelCount);
+
+        delete[] _asyncReadPointers;
+        _asyncReadPointers = nullptr;
+
+        _asyncRendering = false;
+        _addedLatencyFrames.store(0, std::memory_order_relaxed);
+
         delete[] _channelMap;
         _channelMap = nullptr;
         
-        delete[] _gainFactors;
-        _gainFactors = nullptr;
+        delete[] _sourceOutputMap;
+        _sourceOutputMap = nullptr;
+        
+        delete[] _gainRamps;
+        _gainRamps = nullptr;
+        
+        _renderResourcesAllocated = false;
+        
+    }
+    
+    
+    // Returns the latency of this kernel in samples, or zero if render
+    // resources are not allocated. See `SongFinderProcessor::latency`
+    // for exactly what this means. An offline render should discard
+    // this many samples from the start of its output.
+    //
+    // When processing parameters change, this returns the latency of
+    // the old processors until the render thread has warmed up the new
+    // ones and finished crossfading to them, and only then that of the
+    // new ones, so that it always matches the output.
+    //
+    // When rendering asynchronously, this includes the latency added by
+    // the worker thread.
+    AUAudioFrameCount latencyFrames() {
+        if (_renderResourcesAllocated)
+            return _latencyFrames.load(std::memory_order_relaxed) +
+                _addedLatencyFrames.load(std::memory_order_relaxed);
+        else
+            return 0;
+    }
+    
+    
+    // Returns the number of bytes of memory allocated by this kernel's
+    // processors, or zero if render resources are not allocated. While
+    // the kernel is crossfading between processors, this is the size
+    // of the new ones.
+    size_t processorMemorySize() {
+        if (_renderResourcesAllocated)
+            return _processorMemorySize.load(std::memory_order_relaxed);
+        else
+            return 0;
+    }
+    
+    
+    // Returns the number of filter multiply-adds per second performed
+    // by this kernel's processors, or zero if render resources are not
+    // allocated. This is a platform-independent measure of the CPU cost
+    // of the current configuration, for comparing quality tiers. While
+    // the kernel is crossfading between processors, this is the cost
+    // of the new ones.
+    double processingCost() {
+        if (_renderResourcesAllocated)
+            return _processingCost.load(std::memory_order_relaxed);
+        else
+            return 0;
+    }
+    
+    
+    // Returns the sample rate with which render resources were last
+    // allocated.
+    double sampleRate() {
+        return _sampleRate;
+    }
+    
+    
+    // Returns the latency of this kernel in seconds.
+    double latency() {
+        return latencyFrames() / _sampleRate;
+    }
+    
+    
+    // Returns the number of diagnostic events of the specified type
+    // that the kernel's processors have reported. Callable from any
+    // thread.
+    uint64_t diagnosticCount(DiagnosticEventType type) const {
+        return _diagnostics.count(type);
+    }
+    
+    
+    // Returns the largest processor buffer occupancy reported so far,
+    // as a percentage of buffer capacity. Callable from any thread.
+    unsigned bufferHighWaterMark() const {
+        return _diagnostics.high_water_mark();
+    }
+    
+    
+    // Calls `handler` with a message describing each diagnostic event
+    // reported by the kernel's processors since the last call. This
+    // formats the messages, so it must not be called on the render
+    // thread, and it must be called on only one thread.
+    template <class Handler>
+    void drainDiagnostics(Handler handler) {
+        _diagnostics.drain([&handler](const DiagnosticEvent &event) {
+            handler(DiagnosticsRing::format(event));
+        });
+    }
+    
+    
+    // Returns whether the kernel is bypassed, as last set. The render
+    // thread may still be fading to or from the bypassed input.
+    // Callable from any thread.
+    bool isBypassed() {
+        return _bypassed.load(std::memory_order_relaxed);
+    }
+
+    
+    // Sets the size of the blocks in which the processors run their
+    // stages, trading latency for CPU usage. See `SongFinderConfig`.
+    // Like other processing parameter changes, this takes effect when
+    // the builder thread has built new processors.
+    void setProcessingBlockSize(unsigned blockSize) {
+        std::lock_guard<std::mutex> lock(_builderMutex);
+        if (blockSize != _config.blockSize) {
+            _config.blockSize = blockSize;
+            _requestRebuild();
+        }
+    }
+    
+    
+    unsigned processingBlockSize() {
+        std::lock_guard<std::mutex> lock(_builderMutex);
+        return _config.blockSize;
+    }
+    
+    
+    // Sets whether the processors idle while their input has no energy
+    // above the cutoff, and the band power in dBFS above which they
+    // resume. See `ActivityGate`. Like other processing parameter
+    // changes, these take effect when the builder thread has built new
+    // processors.
+    void setActivityGate(bool enabled, float threshold) {
+        std::lock_guard<std::mutex> lock(_builderMutex);
+        if (enabled != _config.activityGate ||
+                threshold != _config.activityGateThreshold) {
+            _config.activityGate = enabled;
+            _config.activityGateThreshold = threshold;
+            _requestRebuild();
+        }
+    }
+    
+    
+    bool activityGate() {
+        std::lock_guard<std::mutex> lock(_builderMutex);
+        return _config.activityGate;
+    }
+    
+    
+    float activityGateThreshold() {
+        std::lock_guard<std::mutex> lock(_builderMutex);
+        return _config.activityGateThreshold;
+    }
+    
+    
+    // Returns the number of channel frames the processors have
+    // rendered, and how many of those they rendered while idle or
+    // skipping silence, since render resources were allocated. Their
+    // ratio is the fraction of the full processing cost saved by the
+    // activity gate and by skipping silence (see
+    // `SongFinderProcessor::silent`). Callable from any thread.
+    uint64_t renderedFrameCount() const {
+        return _renderedFrameCount.load(std::memory_order_relaxed);
+    }
+    
+    
+    uint64_t idleFrameCount() const {
+        return _idleFrameCount.load(std::memory_order_relaxed);
+    }
+
+
+    // Sets whether the kernel renders asynchronously, running its
+    // processors on a worker thread, and the latency in frames that
+    // this adds, which is clamped to [1, `_MAX_ASYNC_LATENCY`]. These
+    // take effect when render resources are next allocated. Callable
+    // from any thread.
+    void setAsyncRendering(bool enabled, AUAudioFrameCount latency) {
+        latency = std::max<AUAudioFrameCount>(1, std::min(latency, _MAX_ASYNC_LATENCY));
+        _asyncRenderingEnabled.store(enabled, std::memory_order_relaxed);
+        _asyncRenderingLatency.store(latency, std::memory_order_relaxed);
+    }
+
+
+    bool asyncRendering() const {
+        return _asyncRenderingEnabled.load(std::memory_order_relaxed);
+    }
+
+
+    AUAudioFrameCount asyncRenderingLatency() const {
+        return _asyncRenderingLatency.load(std::memory_order_relaxed);
+    }
+
+
+    // Returns the number of frames the render thread has passed
+    // through unprocessed since render resources were allocated
+    // because the worker thread of asynchronous rendering fell behind.
+    // Callable from any thread.
+    uint64_t asyncUnderrunFrameCount() const {
+        return _asyncUnderrunFrameCount.load(std::memory_order_relaxed);
+    }
+
+    
+    // Sets the duration and shape of the ramps with which the kernel
+    // smooths gain and balance changes. Gain and balance events
+    // scheduled by the host with their own ramp durations use those
+    // durations instead.
+    void setGainRampDuration(double duration) {
+        _gainRampDuration.store(duration, std::memory_order_relaxed);
+    }
+    
+    
+    double gainRampDuration() {
+        return _gainRampDuration.load(std::memory_order_relaxed);
+    }
+    
+    
+    void setGainRampShape(GainRampShape shape) {
+        _gainRampShape.store(shape, std::memory_order_relaxed);
+    }
+    
+    
+    GainRampShape gainRampShape() {
+        return _gainRampShape.load(std::memory_order_relaxed);
+    }
+    
+    
+    // Starts or stops computing spectra of the input and output of the
+    // first output channel for display. See `SpectrumAnalyzer`. Call
+    // from only one thread.
+    void setSpectrumEnabled(bool enabled) {
+        _spectrumAnalyzer.set_enabled(enabled);
+    }
+    
+    
+    bool spectrumEnabled() const {
+        return _spectrumAnalyzer.enabled();
+    }
+    
+    
+    void setSpectrumFrameRate(double frameRate) {
+        _spectrumAnalyzer.set_frame_rate(frameRate);
+    }
+    
+    
+    double spectrumFrameRate() const {
+        return _spectrumAnalyzer.frame_rate();
+    }
+    
+    
+    // Copies the latest input and output spectra, each of
+    // `SpectrumAnalyzer::bin_count` values in dBFS, to `input` and
+    // `output`. Returns the spectrum frame number, which is zero if
+    // no spectra have been computed. This never waits for the render
+    // thread or the analyzer thread. Call from only one thread.
+    uint64_t readSpectra(float *input, float *output) {
+        return _spectrumAnalyzer.read_spectra(input, output);
+    }
+    
+    
+    // Returns the smoothed peak and RMS output levels of a channel in
+    // dBFS, where full scale is one, or `_LOW_OUTPUT_LEVEL` for a
+    // channel that does not exist or is not metered. These never wait
+    // for the render thread, and are callable from any thread. When
+    // the kernel is not rendering, they return the last levels
+    // metered, or `_LOW_OUTPUT_LEVEL` if render resources have been
+    // reallocated since.
+    float outputPeakLevel(int channelNum) const {
+        if (channelNum >= 0 && channelNum < _MAX_METERED_CHANNELS)
+            return _outputMeters[channelNum].peak_level();
+        else
+            return _LOW_OUTPUT_LEVEL;
+    }
+    
+    
+    float outputRmsLevel(int channelNum) const {
+        if (channelNum >= 0 && channelNum < _MAX_METERED_CHANNELS)
+            return _outputMeters[channelNum].rms_level();
+        else
+            return _LOW_OUTPUT_LEVEL;
+    }
+    
+    
+    // Sets the time constants with which the output meters smooth
+    // their readings. Callable from any thread.
+    void setMeterBallistics(const LevelMeterBallistics &ballistics) {
+        _meterPeakAttack.store(ballistics.peak_attack, std::memory_order_relaxed);
+        _meterPeakRelease.store(ballistics.peak_release, std::memory_order_relaxed);
+        _meterRmsAttack.store(ballistics.rms_attack, std::memory_order_relaxed);
+        _meterRmsRelease.store(ballistics.rms_release, std::memory_order_relaxed);
+    }
+    
+    
+    LevelMeterBallistics meterBallistics() const {
+        LevelMeterBallistics ballistics;
+        ballistics.peak_attack = _meterPeakAttack.load(std::memory_order_relaxed);
+        ballistics.peak_release = _meterPeakRelease.load(std::memory_order_relaxed);
+        ballistics.rms_attack = _meterRmsAttack.load(std::memory_order_relaxed);
+        ballistics.rms_release = _meterRmsRelease.load(std::memory_order_relaxed);
+        return ballistics;
+    }
+    
+    
+    // Sets whether the kernel is bypassed. The render thread picks the
+    // change up at the start of its next render cycle. Callable from
+    // any thread.
+    void setBypassed(bool bypassed) {
+        _bypassed.store(bypassed, std::memory_order_relaxed);
+    }
+
+    
+    void setParameter(AUParameterAddress address, AUValue value) {
+        
+        switch (address) {
+                
+            case Cutoff:
+            case PitchShift:
+            case WindowType:
+            case WindowSize:
+            case Quality:
+                _setConfigParameter(address, value);
+                break;
+                
+            case Gain:
+            case Balance:
+                _sendRenderParameter(address, value);
+                break;
+
+        }
+        
+        
+    }
+
+    
+    // Handles a processor parameter event scheduled by the host. This
+    // is called on the render thread, by `handleUnsplitEvent`, which
+    // handles gain and balance events itself.
+    void handleParameterEvent(AUParameterEvent const &event) override {
+        
+        switch (event.parameterAddress) {
+                
+            case Cutoff:
+            case PitchShift:
+            case WindowType:
+            case WindowSize:
+            case Quality:
+                // The builder thread picks these up when we wake it.
+                // If the queue is full, which would take over a hundred
+                // processor parameter events before the builder wakes,
+                // the event is dropped.
+                _configMessages.push(event.parameterAddress, event.value);
+                _signalBuilder();
+                break;
+                
+        }
+        
+    }
+    
+    
+    void _startEventGainRamps(AUParameterEvent const &event) {
+        
+        // Host ramps are linear in the parameter value, which is in
+        // decibels, so gain factor ramps are exponential. Host jumps
+        // are smoothed like ones from `setParameter`.
+        if (event.rampDurationSampleFrames != 0)
+            _updateGainTargets(event.rampDurationSampleFrames, GainRampShape::Exponential);
+        else
+            _smoothGainTargets();
+        
+    }
+    
+    
+    bool splitsRendering(AURenderEvent const &event) override {
+        
+        // Gain and balance events are applied at their offsets by
+        // `_applyGain`, and processor parameter events take effect
+        // asynchronously in any case.
+        return event.head.eventType != AURenderEventParameter &&
+            event.head.eventType != AURenderEventParameterRamp;
         
-        delete[] _outputLevels;
-        _outputLevels = nullptr;
+    }
+    
+    
+    void handleUnsplitEvent(AURenderEvent const &event, AUAudioFrameCount bufferOffset) override {
         
-        _renderResourcesAllocated = false;
+        const AUParameterEvent &parameterEvent = event.parameter;
+        const AUParameterAddress address = parameterEvent.parameterAddress;
+        
+        if (address == Gain || address == Balance) {
+            
+            _storeRenderParameter(address, parameterEvent.value);
+            
+            if (_gainEventCount != _MAX_GAIN_EVENTS)
+                _gainEvents[_gainEventCount++] = { bufferOffset, parameterEvent };
+            
+            else
+                // event queue full
+                
+                // Drop the event. When `_applyGain` applies the last
+                // queued event it will resynchronize with `_gain` and
+                // `_balance`, which we have just updated.
+                _gainEventsDropped = true;
+            
+        } else
+            // not a gain or balance event
+            
+            handleParameterEvent(parameterEvent);
         
     }
     
     
-    bool isBypassed() {
-        return _bypassed;
+    void _setConfigParameter(AUParameterAddress address, AUValue value) {
+        std::lock_guard<std::mutex> lock(_builderMutex);
+        _setConfigValue(address, value);
+        _requestRebuild();
     }
-
     
-    void setBypassed(bool bypassed) {
-        bypassed = bypassed;
-    }
-
     
-    void setParameter(AUParameterAddress address, AUValue value) {
+    void _setConfigValue(AUParameterAddress address, AUValue value) {
+        
+        // `_builderMutex` must be held by the caller.
         
         switch (address) {
                 
             case Cutoff:
-                _cutoff = value;
-                std::cout << "DSP Kernel: set cutoff to " << _cutoff << std::endl;
+                _config.cutoff = value;
                 break;
                 
             case PitchShift:
-                _pitchShift = value;
-                std::cout << "DSP Kernel: set pitch shift to " << _pitchShift << std::endl;
+                _config.pitchShift = value;
                 break;
                 
             case WindowType:
-                _windowType = value;
-                std::cout << "DSP Kernel: set window type to " << _windowType << std::endl;
+                _config.windowType = value;
                 break;
                 
             case WindowSize:
-                _windowSize = value;
-                std::cout << "DSP Kernel: set window size to " << _windowSize << std::endl;
+                _config.windowSize = value;
                 break;
                 
-            case Gain:
-                _gain = value;
-                std::cout << "DSP Kernel: set gain to " << _gain << std::endl;
-                _updateGainFactors();
+            case Quality:
+                _config.quality = value;
                 break;
                 
-            case Balance:
-                _balance = value;
-                std::cout << "DSP Kernel: set balance to " << _balance << std::endl;
-                _updateGainFactors();
-                break;
-
         }
         
-        
     }
-
     
     
-    AUValue getParameter(AUParameterAddress address) {
+    AUValue _getConfigValue(AUParameterAddress address) {
+        
+        std::lock_guard<std::mutex> lock(_builderMutex);
         
         switch (address) {
                 
             case Cutoff:
-                return _cutoff;
+                return _config.cutoff;
                 
             case PitchShift:
-                return _pitchShift;
+                return _config.pitchShift;
                 
             case WindowType:
-                return _windowType;
+                return _config.windowType;
                 
             case WindowSize:
-                return _windowSize;
-                
-            case Gain:
-                return _gain;
+                return _config.windowSize;
                 
-            case Balance:
-                return _balance;
+            case Quality:
+                return _config.quality;
                 
-            case OutputLevel0:
-                return _getOutputLevel(0);
-
-            case OutputLevel1:
-                return _getOutputLevel(1);
-
             default: return 0;
                 
         }
         
     }
-
     
-    AUValue _getOutputLevel(int channelNum) {
+    
+    void _storeRenderParameter(AUParameterAddress address, AUValue value) {
+        if (address == Gain)
+            _gain.store(value, std::memory_order_relaxed);
+        else
+            _balance.store(value, std::memory_order_relaxed);
+    }
+    
+    
+    void _sendRenderParameter(AUParameterAddress address, AUValue value) {
         
-        // This method always returns something reasonable, even if
-        // `_outputLevels` is not allocated (e.g. if this audio unit is
-        // not running) or the specified channel does not exist (e.g.
-        // channel one when output is mono).
+        _storeRenderParameter(address, value);
         
-        if (_outputLevels != nullptr && channelNum < _outputChannelCount)
-            return _outputLevels[channelNum];
+        // If the queue is full, the render thread is not keeping up
+        // with us, and we ask it to resynchronize with `_gain` and
+        // `_balance` instead. We need not send anything when render
+        // resources are not allocated, since `allocateRenderResources`
+        // synchronizes the render thread with `_gain` and `_balance`.
+        if (_renderResourcesAllocated && !_parameterMessages.push(address, value))
+            _parameterResyncNeeded.store(true, std::memory_order_release);
         
+    }
+    
+    
+    void _applyRenderParameter(AUParameterAddress address, AUValue value) {
+        if (address == Gain)
+            _renderGain = value;
         else
-            // `_outputLevels` is currently unallocated or specified
-            // channel does not exist
-            
-            return _LOW_OUTPUT_LEVEL;
+            _renderBalance = value;
+    }
+    
+    
+    // Called by the render thread at the start of each call to `process`
+    // to apply parameter changes sent by `setParameter`.
+    void _receiveRenderParameters() {
+        
+        size_t count = _parameterMessages.drain([this](const ParameterMessage &message) {
+            _applyRenderParameter(message.address, message.value);
+        });
+        
+        if (_parameterResyncNeeded.exchange(false, std::memory_order_acquire)) {
+            _renderGain = _gain.load(std::memory_order_relaxed);
+            _renderBalance = _balance.load(std::memory_order_relaxed);
+            ++count;
+        }
+        
+        if (count != 0)
+            _smoothGainTargets();
         
     }
     
     
+    AUValue getParameter(AUParameterAddress address) {
+        
+        switch (address) {
+                
+            case Cutoff:
+            case PitchShift:
+            case WindowType:
+            case WindowSize:
+            case Quality:
+                return _getConfigValue(address);
+                
+            case Gain:
+                return _gain.load(std::memory_order_relaxed);
+                
+            case Balance:
+                return _balance.load(std::memory_order_relaxed);
+                
+            case OutputLevel0:
+                return outputRmsLevel(0);
+
+            case OutputLevel1:
+                return outputRmsLevel(1);
+
+            default: return 0;
+                
+        }
+        
+    }
+
+    
     void setBuffers(AudioBufferList* inputBuffers, AudioBufferList* outputBuffers) {
         _inputBuffers = inputBuffers;
         _outputBuffers = outputBuffers;
@@ -269,15 +1502,86 @@ public:
         // std::cout << "SongFinderDSPKernel.process " << frameCount << std::endl;
 
         
+        // Flush subnormal numbers to zero while rendering, so that
+        // audio decaying into silence does not slow processing.
+        const DenormalGuard denormalGuard;
+        
+        _receiveRenderParameters();
+        
+        _updateBypass();
+        
+        const bool suspended = _processorsSuspended();
+        const bool bypassFading = _bypassFading();
+        
+        // Suspended processors are not replaced, so that new ones are
+        // not built for nothing, so leave any new ones pending until
+        // bypass ends. When rendering asynchronously, the worker thread
+        // takes new processors.
+        if (!suspended && !_asyncRendering)
+            _takePendingProcessors();
+        
+        // Tap the input of the first output channel for the spectrum
+        // analyzer before processing, which may overwrite it.
+        const bool tapping =
+            _outputChannelCount != 0 && _spectrumAnalyzer.begin_tap(frameCount);
+        if (tapping) {
+            size_t stride;
+            const float *inputs =
+                _channelData(_inputBuffers, _channelMap[0], bufferOffset, stride);
+            _spectrumAnalyzer.tap_input(inputs, frameCount, stride);
+        }
+        
+        if (_asyncRendering && !suspended)
+            _exchangeAsync(frameCount, bufferOffset);
+
+        // Save the input to fade to or from before processing, which
+        // may overwrite it.
+        if (bypassFading) {
+            for (int j = 0; j != _outputChannelCount; ++j) {
+                size_t inputStride;
+                const float *inputs =
+                    _channelData(_inputBuffers, _channelMap[j], bufferOffset, inputStride);
+                float *bypassInputs = _bypassBuffers[j];
+                for (int k = 0; k != frameCount; ++k)
+                    bypassInputs[k] = inputs[k * inputStride];
+            }
+        }
+
+        // Process the channels of each processor together. Processed
+        // channel `i` is input channel `i` and output channel `i`.
+        if (!suspended && !_asyncRendering) {
+
+            uint64_t renderedFrameCount = _renderedFrameCount.load(std::memory_order_relaxed);
+            uint64_t idleFrameCount = _idleFrameCount.load(std::memory_order_relaxed);
+
+            for (int p = 0; p != _processors->processorCount(); ++p) {
+
+                SongFinderProcessor *processor = _processors->processor(p);
+                const unsigned channelCount = processor->channel_count();
+
+                _processChannels(p, frameCount, bufferOffset);
+
+                renderedFrameCount += frameCount * channelCount;
+                if (processor->idle() || processor->silent())
+                    idleFrameCount += frameCount * channelCount;
+
+            }
+
+            _renderedFrameCount.store(renderedFrameCount, std::memory_order_relaxed);
+            _idleFrameCount.store(idleFrameCount, std::memory_order_relaxed);
+
+        }
+
         for (int j = 0; j != _outputChannelCount; ++j) {
 
             int i = _channelMap[j];
             
-            const float *inputs = (float *) _inputBuffers->mBuffers[i].mData + bufferOffset;
-            float *outputs = (float *) _outputBuffers->mBuffers[j].mData + bufferOffset;
+            size_t inputStride, outputStride;
+            const float *inputs = _channelData(_inputBuffers, i, bufferOffset, inputStride);
+            float *outputs = _channelData(_outputBuffers, j, bufferOffset, outputStride);
 
-            if (_bypassed) {
-                // this audio unit bypassed
+            if (suspended) {
+                // this audio unit bypassed and processors suspended
                     
                 if (outputs == inputs) {
                     // input and output buffers are the same
@@ -288,43 +1592,382 @@ public:
                     // input and output buffers are not the same
 
                     for (int k = 0; k != frameCount; ++k)
-                        outputs[k] = inputs[k];
+                        outputs[k * outputStride] = inputs[k * inputStride];
 
                 }
 
-            } else {
-                // this audio unit not bypassed
-
-                _processors[j]->process(inputs, frameCount, outputs);
+            } else if (_asyncRendering) {
+                // this audio unit not bypassed, and rendering
+                // asynchronously
 
-                float gainFactor = _gainFactors[j];
+                const float *asyncOutputs = _asyncOutputs[i];
                 for (int k = 0; k != frameCount; ++k)
-                    outputs[k] *= gainFactor;
+                    outputs[k * outputStride] = asyncOutputs[k];
 
+            } else if (_sourceOutputMap[j] != -1) {
+                // this audio unit not bypassed, and output channel
+                // shares the processor of an earlier one
+                
+                // Copy the earlier channel's output, to which gain has
+                // not yet been applied.
+                size_t sourceStride;
+                const float *sourceOutputs = _channelData(
+                    _outputBuffers, _sourceOutputMap[j], bufferOffset, sourceStride);
+                if (outputs == sourceOutputs)
+                    continue;
+                else if (outputStride == 1 && sourceStride == 1)
+                    std::memcpy(outputs, sourceOutputs, frameCount * sizeof(float));
+                else
+                    for (int k = 0; k != frameCount; ++k)
+                        outputs[k * outputStride] = sourceOutputs[k * sourceStride];
+                
             }
+
+            // Otherwise this audio unit is not bypassed and the channel
+            // was processed above.
             
         }
+        
+        _applyGain(frameCount, bufferOffset);
+        
+        if (bypassFading)
+            _mixBypass(frameCount, bufferOffset);
+        
+        if (tapping) {
+            size_t stride;
+            const float *outputs = _channelData(_outputBuffers, 0, bufferOffset, stride);
+            _spectrumAnalyzer.tap_output(outputs, frameCount, stride);
+            _spectrumAnalyzer.end_tap(frameCount);
+        }
 
 
-        // compute channel RMS output powers in dBFS, where full scale is 1.
+        _meterOutputs(frameCount, bufferOffset);
         
-        for (int i = 0; i != _outputChannelCount; ++i) {
+        if (!_asyncRendering)
+            _advanceCrossfade(frameCount);
+        
+        _advanceBypassFade(frameCount);
+        
+
+    }
+    
+    
+    // Called by the render thread at the start of each render cycle to
+    // pick up a change to `_bypassed`. Ending bypass while the
+    // processors are suspended resets them, and since reset processors
+    // output the silence they were primed with before any processed
+    // input, holds the bypassed input until they have warmed up, and
+    // only then starts the fade. A change during a fade reverses the
+    // fade from where it is, so the output stays continuous.
+    void _updateBypass() {
+        
+        const bool bypassed = _bypassed.load(std::memory_order_relaxed);
+        
+        if (bypassed == _renderBypassed)
+            return;
+        
+        const bool suspended = _processorsSuspended();
+        
+        if (suspended) {
+            if (_asyncRendering)
+                _resetAsyncProcessors();
+            else
+                _processors->reset();
+        }
+        
+        _renderBypassed = bypassed;
+        _bypassFadePosition = _crossfadeLength -
+            std::clamp<int64_t>(_bypassFadePosition, 0, _crossfadeLength);
+        
+        // When rendering asynchronously, the output of the reset
+        // processors also arrives `_asyncLatency` frames late.
+        if (suspended)
+            _bypassFadePosition -=
+                _warmUpFrames.load(std::memory_order_relaxed) + _asyncLatency;
+        
+    }
+    
+    
+    // Returns `true` if the render thread is fading to or from the
+    // bypassed input, or holding it before fading from it.
+    bool _bypassFading() {
+        return _bypassFadePosition < _crossfadeLength;
+    }
+    
+    
+    // Returns `true` if the render thread is bypassed and has finished
+    // fading to the bypassed input, so that the processors are not run.
+    bool _processorsSuspended() {
+        return _renderBypassed && !_bypassFading();
+    }
+    
+    
+    // Called by the render thread at the end of each render cycle.
+    void _advanceBypassFade(AUAudioFrameCount frameCount) {
+        
+        if (_bypassFading()) {
+            
+            _bypassFadePosition += frameCount;
+            
+            // Suspended processors are reset rather than crossfaded
+            // from when bypass ends, so stop any crossfade now. When
+            // rendering asynchronously, the worker thread does this
+            // when it resets the processors.
+            if (_processorsSuspended() && !_asyncRendering &&
+                    _outgoingProcessors != nullptr)
+                _retireOutgoingProcessors();
+            
+        }
+        
+    }
+    
+    
+    // Fades linearly between the output and the input saved in
+    // `_bypassBuffers`, from the output to the input when entering
+    // bypass and from the input to the output when leaving it,
+    // starting `_bypassFadePosition` samples into the fade. The input
+    // is output unchanged at negative positions.
+    void _mixBypass(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) {
+        
+        const float increment = 1.f / _crossfadeLength;
+        
+        for (int j = 0; j != _outputChannelCount; ++j) {
+            
+            size_t stride;
+            float *outputs = _channelData(_outputBuffers, j, bufferOffset, stride);
+            const float *inputs = _bypassBuffers[j];
+            
+            for (AUAudioFrameCount k = 0; k != frameCount; ++k) {
+                
+                const int64_t position = _bypassFadePosition + k;
+                const float g = position < 0 ? 0 :
+                    position < _crossfadeLength ? (position + 1) * increment : 1;
+                const float inputGain = _renderBypassed ? g : 1 - g;
+                
+                float &output = outputs[k * stride];
+                output += inputGain * (inputs[k] - output);
+                
+            }
+            
+        }
+        
+    }
+    
+    
+    // Called by the render thread when rendering asynchronously to send
+    // `frameCount` input frames to the worker thread and receive as
+    // many output frames from it in `_asyncOutputs`. Output frames
+    // that are not ready are replaced with the input, saved in
+    // `_asyncInputs`.
+    void _exchangeAsync(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) {
+
+        const int channelCount = _asyncChannelCount;
+
+        for (int i = 0; i != channelCount; ++i) {
+            size_t stride;
+            const float *inputs = _channelData(_inputBuffers, i, bufferOffset, stride);
+            float *asyncInputs = _asyncInputs[i];
+            for (int k = 0; k != frameCount; ++k)
+                asyncInputs[k] = inputs[k * stride];
+        }
 
-            float power = 0;
-            float *outputs = (float *) _outputBuffers->mBuffers[i].mData + bufferOffset;
+        uint64_t underrunFrameCount = 0;
 
-            for (int j = 0; j != frameCount; ++j) {
-                const float sample = outputs[j];
-                power += sample * sample;
+        if (_asyncInputRing->reserve(frameCount)) {
+
+            for (int i = 0; i != channelCount; ++i)
+                _asyncInputRing->write(i, _asyncInputs[i], frameCount);
+            _asyncInputRing->commit(frameCount);
+
+            _asyncPushedCount += frameCount;
+            _asyncInFlightCount += frameCount;
+
+            _asyncSignal.fetch_add(1, std::memory_order_release);
+            _asyncSignal.notify_one();
+
+        } else {
+            // input ring full
+
+            // The worker has fallen far behind and these frames are
+            // lost, so discard everything in flight and start over
+            // from passthrough, as after bypass.
+            _asyncStaleCount += _asyncInFlightCount;
+            _asyncInFlightCount = 0;
+            underrunFrameCount += frameCount;
+
+        }
+
+        // Output frames are due when more than `_asyncLatency` frames
+        // are in flight. Frames due before this cycle are late and are
+        // discarded, since we passed the input through in their place.
+        // Until `_asyncLatency` frames are in flight again after bypass
+        // or lost input, the first frames of the cycle are not due, and
+        // we pass the input through.
+        const uint64_t dueCount = _asyncInFlightCount > _asyncLatency ?
+            _asyncInFlightCount - _asyncLatency : 0;
+        const AUAudioFrameCount readCount =
+            static_cast<AUAudioFrameCount>(std::min<uint64_t>(dueCount, frameCount));
+        const uint64_t lateCount = dueCount - readCount;
+        const AUAudioFrameCount fillCount = frameCount - readCount;
+
+        size_t available = _asyncOutputRing->available();
+
+        const size_t staleCount = _asyncOutputRing->discard(
+            std::min<uint64_t>(_asyncStaleCount, available));
+        _asyncStaleCount -= staleCount;
+        available -= staleCount;
+
+        size_t receivedCount = 0;
+
+        if (_asyncStaleCount == 0) {
+
+            const size_t discardedCount =
+                _asyncOutputRing->discard(std::min<uint64_t>(lateCount, available));
+            _asyncInFlightCount -= discardedCount;
+
+            if (discardedCount == lateCount) {
+                for (int i = 0; i != channelCount; ++i)
+                    _asyncReadPointers[i] = _asyncOutputs[i] + fillCount;
+                receivedCount = _asyncOutputRing->read(_asyncReadPointers, readCount);
+                _asyncInFlightCount -= receivedCount;
             }
 
-            power /= frameCount;
-            
-            _outputLevels[i] = 10 * std::log10(power);
+        }
 
+        // Pass the input through in place of frames that are not due
+        // or not ready.
+        for (int i = 0; i != channelCount; ++i) {
+            const float *asyncInputs = _asyncInputs[i];
+            float *asyncOutputs = _asyncOutputs[i];
+            std::memcpy(asyncOutputs, asyncInputs, fillCount * sizeof(float));
+            const size_t end = fillCount + receivedCount;
+            std::memcpy(
+                asyncOutputs + end, asyncInputs + end, (frameCount - end) * sizeof(float));
         }
-        
 
+        underrunFrameCount += readCount - receivedCount;
+
+        if (underrunFrameCount != 0)
+            _asyncUnderrunFrameCount.store(
+                _asyncUnderrunFrameCount.load(std::memory_order_relaxed) + underrunFrameCount,
+                std::memory_order_relaxed);
+
+    }
+
+
+    // Called by the render thread when bypass ends while rendering
+    // asynchronously. Frames in flight were processed or are being
+    // processed from input preceding the bypass, so this marks them
+    // stale, to be discarded on arrival, and has the worker reset the
+    // processors before processing any new input.
+    void _resetAsyncProcessors() {
+        _asyncStaleCount += _asyncInFlightCount;
+        _asyncInFlightCount = 0;
+        _asyncResetPosition.store(_asyncPushedCount, std::memory_order_release);
+    }
+
+
+    // Updates the output meters with `frameCount` output frames
+    // starting at `bufferOffset`. When not bypassed, `_applyGain`
+    // measures the output as it applies gain, so that each output
+    // sample is touched once after the processors write it, and this
+    // just smooths and publishes the measurements. When bypassed or
+    // fading to or from bypass, this measures the output itself.
+    void _meterOutputs(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) {
+        
+        const LevelMeterCoefficients coefficients(
+            meterBallistics(), frameCount / _sampleRate);
+        
+        const int channelCount = std::min(_outputChannelCount, _MAX_METERED_CHANNELS);
+        
+        for (int i = 0; i != channelCount; ++i) {
+            
+            if (_renderBypassed || _bypassFading()) {
+                size_t stride;
+                const float *outputs = _channelData(_outputBuffers, i, bufferOffset, stride);
+                _outputMeters[i].process(outputs, frameCount, coefficients, stride);
+            } else if (frameCount != 0) {
+                _outputMeters[i].update(
+                    _outputPeaks[i], _outputPowerSums[i] / frameCount, coefficients);
+            }
+            
+        }
+        
+    }
+    
+    
+    // Applies channel gains to `frameCount` output frames starting at
+    // `bufferOffset`, applying queued gain and balance events at their
+    // offsets along the way.
+    //
+    // Events less than `_GAIN_EVENT_COALESCING_SIZE` frames after the
+    // first of a run of events are applied together, starting a single
+    // set of gain ramps for the last of them. This bounds the number of
+    // ramps started per render cycle, so dense event lists cost no more
+    // than one event per coalescing window.
+    void _applyGain(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) {
+        
+        for (int i = 0; i != _MAX_METERED_CHANNELS; ++i) {
+            _outputPeaks[i] = 0;
+            _outputPowerSums[i] = 0;
+        }
+        
+        const AUAudioFrameCount end = bufferOffset + frameCount;
+        AUAudioFrameCount position = bufferOffset;
+        int n = 0;
+        
+        while (n != _gainEventCount && _gainEvents[n].bufferOffset < end) {
+            
+            const AUAudioFrameCount offset = std::max(_gainEvents[n].bufferOffset, position);
+            _processGain(position, offset - position);
+            position = offset;
+            
+            const AUAudioFrameCount runEnd = std::min(offset + _GAIN_EVENT_COALESCING_SIZE, end);
+            const AUParameterEvent *event;
+            
+            do {
+                event = &_gainEvents[n++].event;
+                _applyRenderParameter(event->parameterAddress, event->value);
+            } while (n != _gainEventCount && _gainEvents[n].bufferOffset < runEnd);
+            
+            if (n == _gainEventCount && _gainEventsDropped) {
+                _renderGain = _gain.load(std::memory_order_relaxed);
+                _renderBalance = _balance.load(std::memory_order_relaxed);
+                _gainEventsDropped = false;
+            }
+            
+            _startEventGainRamps(*event);
+            
+        }
+        
+        _processGain(position, end - position);
+        
+        // Remove applied events from the queue.
+        if (n != 0) {
+            for (int i = n; i != _gainEventCount; ++i)
+                _gainEvents[i - n] = _gainEvents[i];
+            _gainEventCount -= n;
+        }
+        
+    }
+    
+    
+    void _processGain(AUAudioFrameCount bufferOffset, AUAudioFrameCount frameCount) {
+        
+        if (_processorsSuspended() || frameCount == 0)
+            return;
+        
+        for (int j = 0; j != _outputChannelCount; ++j) {
+            size_t stride;
+            float *outputs = _channelData(_outputBuffers, j, bufferOffset, stride);
+            if (j < _MAX_METERED_CHANNELS)
+                _gainRamps[j].process(
+                    outputs, frameCount, _outputPeaks[j], _outputPowerSums[j],
+                    stride);
+            else
+                _gainRamps[j].process(outputs, frameCount, stride);
+        }
+        
     }
     
     
@@ -337,21 +1980,175 @@ private:
     int _inputChannelCount;
     int _outputChannelCount;
     
+    // sample rate of the input and output, in hertz
+    double _sampleRate = SongFinderProcessor::standard_sample_rate;
+    
     // `_channelMap[i]` is the index of the input channel assigned to output channel `i`.
     int *_channelMap = nullptr;
     
+    // `_sourceOutputMap[i]` is the index of the earlier output channel
+    // whose processor output output channel `i` copies, or -1 if output
+    // channel `i` is processed itself. Output channels are processed
+    // by the processor of their input channel.
+    int *_sourceOutputMap = nullptr;
+    
     unsigned _maxInputSize = 128;
-    AUValue _cutoff = 0;                // Hz
-    AUValue _pitchShift = 2;
-    AUValue _windowType = 0;
-    AUValue _windowSize = 20;           // ms
-    AUValue _gain = 0;                  // dB
-    AUValue _balance = 0;               // dB
-    AUValue *_outputLevels = nullptr;   // dB
-    AUValue *_gainFactors = nullptr;
-    SongFinderProcessor **_processors = nullptr;
-    
-    bool _bypassed = false;
+    SongFinderConfig _config;
+    
+    // gain and balance as last set, for `getParameter`
+    std::atomic<AUValue> _gain = 0;     // dB
+    std::atomic<AUValue> _balance = 0;  // dB
+    
+    // gain and balance in use by the render thread
+    AUValue _renderGain = 0;            // dB
+    AUValue _renderBalance = 0;         // dB
+    
+    // gain and balance changes for the render thread
+    ParameterQueue _parameterMessages;
+    std::atomic<bool> _parameterResyncNeeded = false;
+    
+    // processor parameter changes from the render thread for the builder
+    ParameterQueue _configMessages;
+    
+    LevelMeter _outputMeters[_MAX_METERED_CHANNELS];
+    
+    // output peak magnitudes and sums of squares measured by
+    // `_applyGain` for `_meterOutputs`
+    float _outputPeaks[_MAX_METERED_CHANNELS];
+    float _outputPowerSums[_MAX_METERED_CHANNELS];
+    
+    // meter ballistics, in seconds (see `LevelMeterBallistics`)
+    std::atomic<float> _meterPeakAttack = LevelMeterBallistics().peak_attack;
+    std::atomic<float> _meterPeakRelease = LevelMeterBallistics().peak_release;
+    std::atomic<float> _meterRmsAttack = LevelMeterBallistics().rms_attack;
+    std::atomic<float> _meterRmsRelease = LevelMeterBallistics().rms_release;
+    GainRamp *_gainRamps = nullptr;
+    
+    // gain and balance events to be applied by `_applyGain`
+    struct _GainEvent {
+        AUAudioFrameCount bufferOffset;
+        AUParameterEvent event;
+    };
+    _GainEvent _gainEvents[_MAX_GAIN_EVENTS];
+    int _gainEventCount = 0;
+    bool _gainEventsDropped = false;
+    
+    // smoothing for gain and balance changes without host ramps
+    std::atomic<double> _gainRampDuration = .02;    // seconds
+    std::atomic<GainRampShape> _gainRampShape = GainRampShape::Exponential;
+    SongFinderTuner _tuner;
+    DiagnosticsRing _diagnostics;
+    
+    // See `setLatencyObserver`. The builder thread calls this when
+    // `_latencyFrames` differs from `_notifiedLatencyFrames`.
+    std::function<void()> _latencyObserver;
+    AUAudioFrameCount _notifiedLatencyFrames = 0;
+    
+    // processors in use by the render thread
+    SongFinderProcessorSet *_processors = nullptr;
+    
+    // warm-up size of `_processors`, which the render thread reads
+    // when bypass ends even while the worker thread owns them
+    std::atomic<AUAudioFrameCount> _warmUpFrames = 0;
+    
+    // snapshot of the state of the processors when render resources
+    // were last deallocated, if not yet restored
+    std::vector<char> _savedProcessorState;
+    
+    // processors the render thread is crossfading from, if any
+    SongFinderProcessorSet *_outgoingProcessors = nullptr;
+    AUAudioFrameCount _crossfadeLength = 0;
+    
+    // Position in the crossfade, which is negative while the incoming
+    // processors warm up.
+    int64_t _crossfadePosition = 0;
+    float **_crossfadeBuffers = nullptr;
+
+    // Staging buffers for the channels of a processor whose buffers
+    // have different strides. See `_processChannels`.
+    static const int _STAGING_CHANNEL_COUNT = 2;
+    float **_stagingBuffers = nullptr;
+    
+    // whether the kernel is bypassed, as last set
+    std::atomic<bool> _bypassed = false;
+    
+    // bypass state of the render thread, which fades to or from the
+    // bypassed input, saved in `_bypassBuffers`, over `_crossfadeLength`
+    // samples when `_bypassed` changes. The position is negative while
+    // holding the input for reset processors to warm up.
+    bool _renderBypassed = false;
+    int64_t _bypassFadePosition = 0;
+    float **_bypassBuffers = nullptr;
+
+    // asynchronous rendering mode and added latency as last set, which
+    // take effect when render resources are next allocated
+    std::atomic<bool> _asyncRenderingEnabled = false;
+    std::atomic<AUAudioFrameCount> _asyncRenderingLatency = _DEFAULT_ASYNC_LATENCY;
+
+    // asynchronous rendering mode and added latency in effect
+    bool _asyncRendering = false;
+    AUAudioFrameCount _asyncLatency = 0;
+    std::atomic<AUAudioFrameCount> _addedLatencyFrames = 0;
+
+    // rings that carry input to the worker thread and output back
+    TapRing *_asyncInputRing = nullptr;
+    TapRing *_asyncOutputRing = nullptr;
+    int _asyncChannelCount = 0;
+
+    // render thread copies of the input and output of the processors
+    float **_asyncInputs = nullptr;
+    float **_asyncOutputs = nullptr;
+    float **_asyncReadPointers = nullptr;
+
+    // Frame counts of the render thread. Frames in flight have been
+    // sent to the worker thread, or are the initial silence of the
+    // output ring, and have not yet been received. Stale frames were
+    // in flight when bypass ended, and are discarded on arrival.
+    uint64_t _asyncPushedCount = 0;
+    uint64_t _asyncInFlightCount = 0;
+    uint64_t _asyncStaleCount = 0;
+
+    // Input frame count at which the worker thread resets the
+    // processors, or `_NO_ASYNC_RESET`.
+    static const uint64_t _NO_ASYNC_RESET = UINT64_MAX;
+    std::atomic<uint64_t> _asyncResetPosition = _NO_ASYNC_RESET;
+
+    // worker thread state
+    std::thread _asyncWorker;
+    std::atomic<uint32_t> _asyncSignal = 0;
+    std::atomic<bool> _asyncStopping = false;
+    AUAudioFrameCount _asyncChunkSize = 0;
+    float **_workerInputs = nullptr;
+    float **_workerOutputs = nullptr;
+
+    // Written only by the render thread.
+    std::atomic<uint64_t> _asyncUnderrunFrameCount = 0;
+
+    // processors published by the builder for the render thread
+    std::atomic<SongFinderProcessorSet *> _pendingProcessors = nullptr;
+    
+    // processors retired by the render thread for the builder to delete
+    std::atomic<SongFinderProcessorSet *> _retiredProcessors = nullptr;
+    
+    // incremented to wake the builder thread
+    std::atomic<uint32_t> _builderSignal = 0;
+    
+    // builder thread state, protected by `_builderMutex`
+    std::thread _builderThread;
+    std::mutex _builderMutex;
+    bool _rebuildRequested = false;
+    bool _builderStopping = false;
+    
+    std::atomic<AUAudioFrameCount> _latencyFrames = 0;
+    std::atomic<size_t> _processorMemorySize = 0;
+    std::atomic<double> _processingCost = 0;
+    
+    SpectrumAnalyzer _spectrumAnalyzer;
+    
+    // Written only by the render thread.
+    std::atomic<uint64_t> _renderedFrameCount = 0;
+    std::atomic<uint64_t> _idleFrameCount = 0;
+    
     AudioBufferList* _inputBuffers = nullptr;
     AudioBufferList* _outputBuffers = nullptr;
     
@@ -12,12 +12,94 @@ NS_ASSUME_NONNULL_BEGIN
 @interface SongFinderDSPKernelAdapter : NSObject
 
 @property (nonatomic) AUAudioFrameCount maximumFramesToRender;
+@property (nonatomic) AUAudioFrameCount minimumSegmentSize;
 @property (nonatomic, readonly) AUAudioUnitBus *inputBus;
 @property (nonatomic, readonly) AUAudioUnitBus *outputBus;
+@property (nonatomic, readonly) NSTimeInterval latency;
+
+// Called on a background thread when `latency` changes while render
+// resources are allocated. Set this only while they are not.
+@property (nonatomic, copy, nullable) void (^latencyObserver)(void);
+
+@property (nonatomic, readonly) NSUInteger processorMemorySize;
+
+// Number of filter multiply-adds per second performed by the kernel's
+// processors, a platform-independent measure of processing cost.
+@property (nonatomic, readonly) double processingCost;
+
+// Size of the blocks in which the kernel's processors run, or zero to
+// run them on blocks as the host provides them. Larger blocks use less
+// CPU at small host block sizes but add `processingBlockSize - 1`
+// frames of latency.
+@property (nonatomic) AUAudioFrameCount processingBlockSize;
+
+// Whether the kernel's processors idle while their input has no
+// energy above the cutoff, and the band power in dBFS above which
+// they resume.
+@property (nonatomic) BOOL activityGate;
+@property (nonatomic) float activityGateThreshold;
+
+// Counts of channel frames rendered by the processors, and of those
+// rendered while idle or skipping silent input.
+@property (nonatomic, readonly) UInt64 renderedFrameCount;
+@property (nonatomic, readonly) UInt64 idleFrameCount;
+
+// Whether the kernel runs its processors on a worker thread rather
+// than the render thread, and the latency in frames this adds. These
+// take effect when render resources are next allocated.
+@property (nonatomic) BOOL asyncRendering;
+@property (nonatomic) AUAudioFrameCount asyncRenderingLatency;
+
+// Number of frames passed through unprocessed because the worker
+// thread of asynchronous rendering fell behind.
+@property (nonatomic, readonly) UInt64 asyncUnderrunFrameCount;
+
+// Whether the kernel computes spectra of the input and output of the
+// first output channel for display, and how many per second. Spectra
+// have `spectrumBinCount` bins `spectrumBinWidth` hertz apart.
+@property (nonatomic) BOOL spectrumEnabled;
+@property (nonatomic) double spectrumFrameRate;
+@property (nonatomic, readonly) NSUInteger spectrumBinCount;
+@property (nonatomic, readonly) double spectrumBinWidth;
+
+// Time constants in seconds of the smoothing of the output level
+// meters' peak and RMS readings as they rise (attack) and fall
+// (release). A zero attack time makes a reading rise instantly.
+@property (nonatomic) NSTimeInterval meterPeakAttack;
+@property (nonatomic) NSTimeInterval meterPeakRelease;
+@property (nonatomic) NSTimeInterval meterRmsAttack;
+@property (nonatomic) NSTimeInterval meterRmsRelease;
+
+// Duration and shape of the ramps that smooth gain and balance changes.
+// Ramps are exponential (linear in decibels) unless `linearGainRamps`.
+@property (nonatomic) NSTimeInterval gainRampDuration;
+@property (nonatomic) BOOL linearGainRamps;
+
+// Counts of diagnostic events reported by the render thread.
+@property (nonatomic, readonly) UInt64 zeroFillCount;
+@property (nonatomic, readonly) UInt64 oversizeBlockCount;
+@property (nonatomic, readonly) UInt64 bufferOverflowCount;
+@property (nonatomic, readonly) UInt64 bufferUnderflowCount;
+
+// Largest processor buffer occupancy so far, in percent of capacity.
+@property (nonatomic, readonly) NSUInteger bufferHighWaterMark;
 
 - (void)setParameter:(AUParameter *)parameter value:(AUValue)value;
 - (AUValue)valueForParameter:(AUParameter *)parameter;
 
+// Smoothed peak and RMS output levels of a channel in dBFS. These
+// never wait for the render thread.
+- (float)outputPeakLevelForChannel:(NSInteger)channel;
+- (float)outputRmsLevelForChannel:(NSInteger)channel;
+
+- (NSArray<NSString *> *)drainDiagnosticMessages;
+
+// Copies the latest input and output spectra in dBFS to `input` and
+// `output`, which must each have room for `spectrumBinCount` values.
+// Returns the spectrum frame number, which is zero if no spectra have
+// been computed. Never waits for the render thread.
+- (UInt64)readSpectraInput:(float *)input output:(float *)output;
+
 - (void)allocateRenderResources;
 - (void)deallocateRenderResources;
 - (AUInternalRenderBlock)internalRenderBlock;
@@ -22,7 +22,9 @@
 
     if (self = [super init]) {
         
-        int sampleRate = 48000;
+        // The kernel supports other sample rates, with which hosts can
+        // replace this default.
+        int sampleRate = SongFinderProcessor::standard_sample_rate;
         int maxChannelCount = 2;
         
         AVAudioFormat *defaultFormat = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:sampleRate channels:maxChannelCount];
@@ -34,6 +36,14 @@
         _outputBus = [[AUAudioUnitBus alloc] initWithFormat:defaultFormat error:nil];
         _outputBus.maximumChannelCount = maxChannelCount;
         
+        // Have the kernel remember which processor stage implementations
+        // are fastest on this device from one run of the app to the next.
+        NSURL *cachesUrl = [NSFileManager.defaultManager URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask].firstObject;
+        if (cachesUrl != nil) {
+            NSURL *profileUrl = [cachesUrl URLByAppendingPathComponent:@"SongFinderKernels.profile"];
+            _kernel.setTuningProfilePath(profileUrl.path.UTF8String);
+        }
+        
     }
     
     return self;
@@ -44,6 +54,201 @@
     return _inputBus.bus;
 }
 
+- (NSTimeInterval)latency {
+    return _kernel.latency();
+}
+
+- (void)setLatencyObserver:(void (^)(void))latencyObserver {
+    _latencyObserver = [latencyObserver copy];
+    void (^observer)(void) = _latencyObserver;
+    if (observer != nil)
+        _kernel.setLatencyObserver([observer]() { observer(); });
+    else
+        _kernel.setLatencyObserver(nullptr);
+}
+
+- (NSUInteger)processorMemorySize {
+    return _kernel.processorMemorySize();
+}
+
+- (double)processingCost {
+    return _kernel.processingCost();
+}
+
+- (AUAudioFrameCount)processingBlockSize {
+    return _kernel.processingBlockSize();
+}
+
+- (void)setProcessingBlockSize:(AUAudioFrameCount)processingBlockSize {
+    _kernel.setProcessingBlockSize(processingBlockSize);
+}
+
+- (BOOL)activityGate {
+    return _kernel.activityGate();
+}
+
+- (void)setActivityGate:(BOOL)activityGate {
+    _kernel.setActivityGate(activityGate, _kernel.activityGateThreshold());
+}
+
+- (float)activityGateThreshold {
+    return _kernel.activityGateThreshold();
+}
+
+- (void)setActivityGateThreshold:(float)activityGateThreshold {
+    _kernel.setActivityGate(_kernel.activityGate(), activityGateThreshold);
+}
+
+- (UInt64)renderedFrameCount {
+    return _kernel.renderedFrameCount();
+}
+
+- (UInt64)idleFrameCount {
+    return _kernel.idleFrameCount();
+}
+
+- (BOOL)asyncRendering {
+    return _kernel.asyncRendering();
+}
+
+- (void)setAsyncRendering:(BOOL)asyncRendering {
+    _kernel.setAsyncRendering(asyncRendering, _kernel.asyncRenderingLatency());
+}
+
+- (AUAudioFrameCount)asyncRenderingLatency {
+    return _kernel.asyncRenderingLatency();
+}
+
+- (void)setAsyncRenderingLatency:(AUAudioFrameCount)asyncRenderingLatency {
+    _kernel.setAsyncRendering(_kernel.asyncRendering(), asyncRenderingLatency);
+}
+
+- (UInt64)asyncUnderrunFrameCount {
+    return _kernel.asyncUnderrunFrameCount();
+}
+
+- (BOOL)spectrumEnabled {
+    return _kernel.spectrumEnabled();
+}
+
+- (void)setSpectrumEnabled:(BOOL)spectrumEnabled {
+    _kernel.setSpectrumEnabled(spectrumEnabled);
+}
+
+- (double)spectrumFrameRate {
+    return _kernel.spectrumFrameRate();
+}
+
+- (void)setSpectrumFrameRate:(double)spectrumFrameRate {
+    _kernel.setSpectrumFrameRate(spectrumFrameRate);
+}
+
+- (NSUInteger)spectrumBinCount {
+    return SpectrumAnalyzer::bin_count;
+}
+
+- (double)spectrumBinWidth {
+    return _kernel.sampleRate() / SpectrumAnalyzer::fft_size;
+}
+
+- (UInt64)readSpectraInput:(float *)input output:(float *)output {
+    return _kernel.readSpectra(input, output);
+}
+
+- (NSTimeInterval)meterPeakAttack {
+    return _kernel.meterBallistics().peak_attack;
+}
+
+- (void)setMeterPeakAttack:(NSTimeInterval)meterPeakAttack {
+    LevelMeterBallistics ballistics = _kernel.meterBallistics();
+    ballistics.peak_attack = meterPeakAttack;
+    _kernel.setMeterBallistics(ballistics);
+}
+
+- (NSTimeInterval)meterPeakRelease {
+    return _kernel.meterBallistics().peak_release;
+}
+
+- (void)setMeterPeakRelease:(NSTimeInterval)meterPeakRelease {
+    LevelMeterBallistics ballistics = _kernel.meterBallistics();
+    ballistics.peak_release = meterPeakRelease;
+    _kernel.setMeterBallistics(ballistics);
+}
+
+- (NSTimeInterval)meterRmsAttack {
+    return _kernel.meterBallistics().rms_attack;
+}
+
+- (void)setMeterRmsAttack:(NSTimeInterval)meterRmsAttack {
+    LevelMeterBallistics ballistics = _kernel.meterBallistics();
+    ballistics.rms_attack = meterRmsAttack;
+    _kernel.setMeterBallistics(ballistics);
+}
+
+- (NSTimeInterval)meterRmsRelease {
+    return _kernel.meterBallistics().rms_release;
+}
+
+- (void)setMeterRmsRelease:(NSTimeInterval)meterRmsRelease {
+    LevelMeterBallistics ballistics = _kernel.meterBallistics();
+    ballistics.rms_release = meterRmsRelease;
+    _kernel.setMeterBallistics(ballistics);
+}
+
+- (float)outputPeakLevelForChannel:(NSInteger)channel {
+    return _kernel.outputPeakLevel(static_cast<int>(channel));
+}
+
+- (float)outputRmsLevelForChannel:(NSInteger)channel {
+    return _kernel.outputRmsLevel(static_cast<int>(channel));
+}
+
+- (NSTimeInterval)gainRampDuration {
+    return _kernel.gainRampDuration();
+}
+
+- (void)setGainRampDuration:(NSTimeInterval)gainRampDuration {
+    _kernel.setGainRampDuration(gainRampDuration);
+}
+
+- (BOOL)linearGainRamps {
+    return _kernel.gainRampShape() == GainRampShape::Linear;
+}
+
+- (void)setLinearGainRamps:(BOOL)linearGainRamps {
+    _kernel.setGainRampShape(linearGainRamps ? GainRampShape::Linear : GainRampShape::Exponential);
+}
+
+- (UInt64)zeroFillCount {
+    return _kernel.diagnosticCount(DiagnosticEventType::ZeroFill);
+}
+
+- (UInt64)oversizeBlockCount {
+    return _kernel.diagnosticCount(DiagnosticEventType::OversizeBlock);
+}
+
+- (UInt64)bufferOverflowCount {
+    return _kernel.diagnosticCount(DiagnosticEventType::BufferOverflow);
+}
+
+- (UInt64)bufferUnderflowCount {
+    return _kernel.diagnosticCount(DiagnosticEventType::BufferUnderflow);
+}
+
+- (NSUInteger)bufferHighWaterMark {
+    return _kernel.bufferHighWaterMark();
+}
+
+// Returns messages describing the diagnostic events reported by the
+// render thread since the last call. Call from only one thread.
+- (NSArray<NSString *> *)drainDiagnosticMessages {
+    NSMutableArray<NSString *> *messages = [NSMutableArray array];
+    _kernel.drainDiagnostics([messages](const std::string &message) {
+        [messages addObject:[NSString stringWithUTF8String:message.c_str()]];
+    });
+    return messages;
+}
+
 - (void)setParameter:(AUParameter *)parameter value:(AUValue)value {
     _kernel.setParameter(parameter.address, value);
 }
@@ -60,6 +265,14 @@
     _kernel.setMaximumFramesToRender(maximumFramesToRender);
 }
 
+- (AUAudioFrameCount)minimumSegmentSize {
+    return _kernel.minimumSegmentSize();
+}
+
+- (void)setMinimumSegmentSize:(AUAudioFrameCount)minimumSegmentSize {
+    _kernel.setMinimumSegmentSize(minimumSegmentSize);
+}
+
 - (BOOL)shouldBypassEffect {
     return _kernel.isBypassed();
 }
@@ -70,7 +283,7 @@
 
 - (void)allocateRenderResources {
     _inputBus.allocateRenderResources(self.maximumFramesToRender);
-    _kernel.allocateRenderResources(self.inputBus.format.channelCount, self.outputBus.format.channelCount);
+    _kernel.allocateRenderResources(self.inputBus.format.channelCount, self.outputBus.format.channelCount, self.outputBus.format.sampleRate);
 }
 
 - (void)deallocateRenderResources {
@@ -13,7 +13,7 @@ public struct SongFinderParameters {
 
     
     private enum ParameterAddress: AUParameterAddress {
-        case cutoff, pitchShift, windowType, windowSize, gain, balance, outputLevel0, outputLevel1
+        case cutoff, pitchShift, windowType, windowSize, gain, balance, outputLevel0, outputLevel1, quality
     }
     
     
@@ -37,6 +37,8 @@ public struct SongFinderParameters {
     
     private static let minOutputLevel: AUValue = -100
     private static let maxOutputLevel: AUValue = 0
+    
+    private static let qualityNames = ["Standard", "Balanced", "Economy"]
 
     
     public let cutoff: AUParameter = {
@@ -207,6 +209,30 @@ public struct SongFinderParameters {
     }()
     
     
+    // Processing quality tier. Lower tiers use shorter filters with
+    // wider transition bands and less stopband attenuation, and thus
+    // less CPU.
+    public let quality: AUParameter = {
+        
+        let parameter = AUParameterTree.createParameter(
+            withIdentifier: "quality",
+            name: "Quality",
+            address: ParameterAddress.quality.rawValue,
+            min: 0,
+            max: AUValue(qualityNames.count - 1),
+            unit: .indexed,
+            unitName: nil,
+            flags: [.flag_IsReadable, .flag_IsWritable],
+            valueStrings: qualityNames,
+            dependentParameters: nil)
+        
+        parameter.value = 0
+
+        return parameter
+        
+    }()
+    
+    
     public let parameterTree: AUParameterTree
 
     
@@ -214,7 +240,7 @@ public struct SongFinderParameters {
 
         // Create the audio unit's tree of parameters
         parameterTree = AUParameterTree.createTree(
-            withChildren: [cutoff, pitchShift, windowType, windowSize, gain, balance, outputLevel0, outputLevel1])
+            withChildren: [cutoff, pitchShift, windowType, windowSize, gain, balance, outputLevel0, outputLevel1, quality])
 
         // Closure observing all externally-generated parameter value changes.
         parameterTree.implementorValueObserver = { param, value in
@@ -238,6 +264,10 @@ public struct SongFinderParameters {
                 ParameterAddress.outputLevel0.rawValue,
                 ParameterAddress.outputLevel1.rawValue:
                 return String(format: "%.f", value ?? param.value)
+            case ParameterAddress.quality.rawValue:
+                let index = Int(value ?? param.value)
+                return SongFinderParameters.qualityNames.indices.contains(index) ?
+                    SongFinderParameters.qualityNames[index] : "?"
             default:
                 return "?"
             }
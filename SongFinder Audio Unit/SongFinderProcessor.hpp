@@ -2,11 +2,19 @@
 #define SONG_FINDER_PROCESSOR
 
 
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <map>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <vector>
+#include "ActivityGate.hpp"
 #include "AdvancingBuffer.hpp"
+#include "DiagnosticsRing.hpp"
+#include "FilterDesign.hpp"
 #include "FirFilter.hpp"
 #include "HbaFilters.hpp"
 #include "Interpolator.hpp"
@@ -15,21 +23,115 @@
 
 using std::map;
 using std::string;
+using std::tuple;
 using std::vector;
 
 
-// forward function declarations
-vector<float> _get_hp_filter_coeffs(unsigned);
-vector<float> _get_interpolator_filter_coeffs(unsigned);
+// Quality tiers, which trade filter quality for CPU usage. See the
+// comment near the end of this file for the filter specifications.
+enum class SongFinderQuality {
+    Standard,
+    Balanced,
+    Economy
+};
 
 
-// TODO: Understand and document conditions under which subprocessors
-// will always produce same number of outputs as inputs. I think this
-// is if you prime the input with one window's worth of samples, but
-// I'm not sure if that's true and why. If we can provide such a
-// (conditional) guarantee, remove zero padding from `process` method.
-// Also make `prime_input` argument optional, and have it default to
-// the minimum number of priming samples needed for guarantee.
+// forward function declarations
+vector<float> _get_hp_filter_coeffs(unsigned, SongFinderQuality, double);
+vector<float> _get_interpolator_filter_coeffs(
+    unsigned, SongFinderQuality = SongFinderQuality::Standard);
+
+
+// Why a processor always has enough output
+//
+// Let D be the pitch shift factor and W the overlap-adder window
+// size in samples, which is a multiple of D. Each time the
+// overlap-adder has a full window of input it processes it, producing
+// W / D output samples. The highpass filter and interpolator are
+// primed so that they produce exactly one and D output samples,
+// respectively, for each input sample, and they process all of
+// their input whenever they run. So once a processor primed with P
+// zeros has been given n input samples, in blocks of any sizes, it
+// has produced
+//
+//     W * floor((n + P) / W)
+//
+// output samples. This is at least n for every n if and only if
+// P >= W - 1. (If P < W - 1, it is less than n when n = 1.) And
+// when P = W - 1 it never exceeds n by more than W - 1.
+//
+// A processor therefore primes its input with W - 1 zeros when it is
+// created. That is the minimum priming that lets `process` always
+// output as many samples as it is given, without padding with zeros.
+//
+// Buffer sizes
+//
+// Knowing exactly how much output the stages produce also tells us
+// exactly how much each buffer must hold. Let M be the max input size,
+// S = W / D the overlap-adder segment size, L the highpass filter
+// length, and R the interpolator input record size. Then:
+//
+// * The input buffer holds at most W - 1 unprocessed samples between
+//   calls, plus at most M new ones, for W - 1 + M in all.
+//
+// * The overlap-adder processes at most K = floor((W - 1 + M) / W)
+//   windows per call, producing at most K * S samples.
+//
+// * The highpass filter keeps L - 1 samples of history in its input
+//   buffer and the interpolator keeps R - 1, so those buffers need
+//   room for that many samples plus K * S. (With a zero cutoff
+//   there is no highpass filter and the interpolator reads the
+//   overlap-adder output directly.)
+//
+// * The output buffer holds the samples produced beyond those
+//   requested, which as shown above never number more than W - 1,
+//   plus while the interpolator runs fewer than D samples that it
+//   moves to the caller's output. So it needs room for W + D - 2.
+//
+// The buffers are allocated at exactly these sizes.
+//
+// Processing blocks
+//
+// By default the stages run on each block of input as the caller
+// provides it, however small. A processor can instead be given a
+// processing block size B, in which case it collects input in a block
+// input buffer and runs the stages only on whole blocks of B samples,
+// so that per-call overhead is amortized over B samples however small
+// the caller's blocks are. The stages then see a max input size of B
+// rather than M, and the sizes above are computed accordingly.
+//
+// Each block yields exactly B output samples, which go to a block
+// output buffer primed with B - 1 zeros. The two block buffers thus
+// hold B - 1 samples in all after each call, and B - 1 + n once n new
+// input samples arrive. After the whole blocks among those are
+// processed, fewer than B samples remain in the input buffer, so the
+// output buffer holds at least n, as many as the caller asks for.
+// (B - 1 is the minimum extra latency for which this holds when
+// n = 1.) The block buffers hold at most B - 1 + M samples each.
+//
+// Channels
+//
+// A processor can process a pair of channels, such as the two
+// channels of a stereo stream, rather than just one. It then keeps
+// the pair interleaved in all of its buffers, and its stages load each
+// filter or window coefficient once per frame for both channels
+// rather than once per sample, so the pair costs noticeably less than
+// two one-channel processors. Everything above holds with "frames" in
+// place of "samples", and each buffer holds twice as many floats.
+// Each channel of the output is exactly the output of a one-channel
+// processor with the same configuration, except that the two channels
+// share the decisions of whether to idle and whether to skip silence:
+// the stages idle only when both activity gates are closed, and
+// silence is skipped only when both channels have been silent for the
+// silence horizon. Each channel's gate still fades its own output.
+
+
+// The inner loop implementations used by the stages of a
+// `SongFinderProcessor`. See `SongFinderTuner` for how these are chosen.
+struct SongFinderKernels {
+    FirKernel fir = FirKernel::Direct;
+    InterpolatorKernel interpolator = InterpolatorKernel::Direct;
+};
 
 
 class SongFinderProcessor {
@@ -38,9 +140,16 @@ class SongFinderProcessor {
 public:
 
 
-    // The SongFinder sample rate is fixed so we can design its
-    // filters in advance.
-    static constexpr double sample_rate = 48000;
+    // The sample rate for which the `Standard` quality tier's highpass
+    // filters were designed in advance. At other rates they are
+    // designed when a processor is created. See the comment near the
+    // end of this file.
+    static constexpr double standard_sample_rate = 48000;
+
+
+    // Magnitude below which input samples count as silent, which is
+    // -200 dBFS. See `silent`.
+    static constexpr float silence_threshold = 1e-10f;
 
 
     SongFinderProcessor(
@@ -49,117 +158,556 @@ public:
         unsigned cutoff,
         unsigned pitch_shift_factor,
         string window_type,
-        double window_size
+        double window_size,
+        SongFinderKernels kernels = SongFinderKernels(),
+        size_t block_size = 0,
+        SongFinderQuality quality = SongFinderQuality::Standard,
+        const ActivityGateSettings &gate_settings = ActivityGateSettings(),
+        double sample_rate = standard_sample_rate,
+        unsigned channel_count = 1
 
 	) :
 
         _max_input_size(max_input_size),
+        _block_size(block_size),
+        _quality(quality),
         _cutoff(cutoff),
 	    _pitch_shift_factor(pitch_shift_factor),
         _window_type(window_type),
         _window_size(window_size),
+        _sample_rate(sample_rate),
+        _channel_count(channel_count),
 
-        _input_buffer(_buffer_size * _max_input_size),
-        _ola_buffer(_buffer_size * _max_input_size / _pitch_shift_factor),
-        _hp_buffer(_buffer_size * _max_input_size / _pitch_shift_factor),
-        _output_buffer(_buffer_size * _max_input_size),
+        _buffer_sizes(_get_buffer_sizes()),
+        _block_input_buffer(_buffer_sizes.block),
+        _block_output_buffer(_buffer_sizes.block),
+        _input_buffer(_buffer_sizes.input),
+        _ola_buffer(_buffer_sizes.ola),
+        _hp_buffer(_buffer_sizes.hp),
+        _output_buffer(_buffer_sizes.output),
 
         _overlap_adder(
-            _pitch_shift_factor, _window_type, _window_size, sample_rate,
-            _input_buffer, _ola_buffer),
+            _pitch_shift_factor, _window_type, _window_size, _sample_rate,
+            _input_buffer, _ola_buffer, _channel_count),
 
-        _hp_filter(_get_hp_filter_coeffs(_cutoff), _ola_buffer, _hp_buffer),
+        _hp_filter(
+            _get_hp_filter_coeffs(_cutoff, _quality, _sample_rate),
+            _ola_buffer, _hp_buffer, kernels.fir, _channel_count),
 
         _interpolator(
             _pitch_shift_factor,
-            _get_interpolator_filter_coeffs(_pitch_shift_factor),
+            _get_interpolator_filter_coeffs(_pitch_shift_factor, _quality),
             _cutoff == 0 ? _ola_buffer : _hp_buffer,
-            _output_buffer),
-
-        _input_buffer_num(0)
+            _output_buffer,
+            kernels.interpolator,
+            _channel_count),
+
+        _gates {
+            ActivityGate(gate_settings, _cutoff, _sample_rate),
+            ActivityGate(gate_settings, _cutoff, _sample_rate)
+        },
+
+        _priming_size(0),
+        _silence_horizon(0),
+        _silent_sizes { 0, 0 },
+        _silent(false),
+        _silence_skipping(true),
+        _diagnostics(nullptr),
+        _channel(0),
+        _input_buffer_num(0),
+        _oversize_size(0)
 	
 	{
 
-    }
+        _prime_input(minimum_priming_size());
 
+        if (_block_size != 0)
+            _block_output_buffer.append_zeros(
+                (_block_size - 1) * _channel_count);
+
+        _silence_horizon = _get_silence_horizon();
 
-    void prime_input(size_t input_count) {
-        _input_buffer.append_zeros(input_count);
     }
 
 
+    // Returns this processor to the state it was created in, as if it
+    // had never processed anything. This does not allocate, so it can
+    // be called on the render thread, for example to resume processing
+    // after a pause without first outputting stale audio from before
+    // it.
+    void reset() {
 
-    void process(const float *input, size_t input_count, float *output) {
+        _block_input_buffer.clear();
+        _block_output_buffer.clear();
+        _input_buffer.clear();
+        _ola_buffer.clear();
+        _hp_buffer.clear();
+        _output_buffer.clear();
 
-        size_t output_count = 0;
-        size_t zero_count = 0;
+        // Prime the stages and buffers in the same order as the
+        // constructor.
+        _overlap_adder.reset();
+        _hp_filter.reset();
+        _interpolator.reset();
 
-        if (input_count > _max_input_size) {
-            // input count exceeds max configured size
+        for (ActivityGate &gate : _gates)
+            gate.reset();
+        _hp_filter.set_idle(false);
+        _interpolator.set_idle(false);
 
-            zero_count = input_count;
+        _priming_size = 0;
+        _prime_input(minimum_priming_size());
 
-        } else {
-            // input count does not exceed max configured size
+        if (_block_size != 0)
+            _block_output_buffer.append_zeros(
+                (_block_size - 1) * _channel_count);
 
-            // Process input.
-            _input_buffer.append(input, input_count);
-            _overlap_adder.process();
+        for (size_t &silent_size : _silent_sizes)
+            silent_size = 0;
+        _silent = false;
 
-            if (_cutoff == 0) {
-                _interpolator.process();
-            } else {
-                _hp_filter.process();
-                _interpolator.process();
-            }
+    }
 
-            // Update output and zero counts as needed.
-            output_count = _output_buffer.size();
-            if (output_count > input_count)
-                output_count = input_count;
-            else if (output_count < input_count)
-                zero_count = input_count - output_count;
 
+    // Returns the size in bytes of a snapshot of this processor's
+    // state. This depends only on the processor's configuration.
+    size_t state_size() {
+        size_t float_count = _overlap_adder.state_size();
+        for (AdvancingBuffer<float> *buffer : _get_buffers())
+            float_count += buffer->capacity();
+        return sizeof(_State) + float_count * sizeof(float);
+    }
+
+
+    // Writes a snapshot of this processor's live state, comprising the
+    // contents of its buffers, its overlap-adder accumulator, the
+    // states of its activity gates and whether its stages are idling,
+    // its silence skipping state, and its input block count, which
+    // numbers diagnostic events, to `state`, which must have room for
+    // `state_size()` bytes. A processor with the same configuration
+    // into which the snapshot is restored continues exactly where this
+    // one was, without the startup silence of a newly primed processor.
+    // Neither saving nor restoring allocates, so both can be done on
+    // the render thread.
+    void save_state(void *state) {
+
+        _State header;
+        header.max_input_size = _max_input_size;
+        header.block_size = _block_size;
+        header.quality = _quality;
+        header.cutoff = _cutoff;
+        header.pitch_shift_factor = _pitch_shift_factor;
+        std::strncpy(
+            header.window_type, _window_type.c_str(),
+            sizeof(header.window_type) - 1);
+        header.window_type[sizeof(header.window_type) - 1] = 0;
+        header.window_size = _window_size;
+        header.sample_rate = _sample_rate;
+        header.channel_count = _channel_count;
+        for (size_t i = 0; i != _max_channel_count; ++i) {
+            header.gates[i] = _gates[i].state();
+            header.silent_sizes[i] = _silent_sizes[i];
         }
+        header.silent = _silent;
+        header.hp_filter_idle = _hp_filter.idle();
+        header.interpolator_idle = _interpolator.idle();
+        header.input_buffer_num = _input_buffer_num;
 
-        if (output_count != 0) {
+        const auto buffers = _get_buffers();
+        for (size_t i = 0; i != buffers.size(); ++i)
+            header.buffer_sizes[i] = buffers[i]->size();
 
-            // Copy from processor output buffer to output array.
-            const float *data = _output_buffer.data();
-            const size_t size = output_count * sizeof(float);
-            std::memcpy(output, data, size);
+        char *bytes = static_cast<char *>(state);
+        std::memcpy(bytes, &header, sizeof(header));
 
-            // Discard copied samples from processor output buffer.
-            _output_buffer.discard(output_count);
+        float *data = reinterpret_cast<float *>(bytes + sizeof(header));
+        _overlap_adder.save_state(data);
+        data += _overlap_adder.state_size();
 
+        for (AdvancingBuffer<float> *buffer : buffers) {
+            std::memcpy(data, buffer->data(), buffer->size() * sizeof(float));
+            data += buffer->size();
         }
 
-        if (zero_count != 0) {
+    }
+
+
+    // Restores a snapshot written by `save_state`. Returns `false`,
+    // leaving this processor unchanged, if the snapshot is of a
+    // processor with a different configuration. The activity gate
+    // settings need not match. If this processor's gates are disabled,
+    // its stages do not idle whatever the snapshot says.
+    bool restore_state(const void *state) {
+
+        const char *bytes = static_cast<const char *>(state);
 
-            for (size_t i = 0; i != zero_count; ++i)
-                output[i] = 0;
+        _State header;
+        std::memcpy(&header, bytes, sizeof(header));
 
-            std::cout << "SongFinderProcessor: " << _input_buffer_num <<
-                " " << input_count << " " << output_count << " " <<
-                zero_count << std::endl;
+        if (!_matches(header))
+            return false;
 
+        const auto buffers = _get_buffers();
+        for (size_t i = 0; i != buffers.size(); ++i)
+            if (header.buffer_sizes[i] > buffers[i]->capacity())
+                return false;
+
+        const float *data =
+            reinterpret_cast<const float *>(bytes + sizeof(header));
+        _overlap_adder.restore_state(data);
+        data += _overlap_adder.state_size();
+
+        for (size_t i = 0; i != buffers.size(); ++i) {
+            buffers[i]->clear();
+            buffers[i]->append(data, header.buffer_sizes[i]);
+            data += header.buffer_sizes[i];
         }
 
-        _input_buffer_num += 1;
+        for (size_t i = 0; i != _max_channel_count; ++i) {
+            _gates[i].set_state(header.gates[i]);
+            _silent_sizes[i] = header.silent_sizes[i];
+        }
+        _silent = header.silent;
+
+        const bool gates_enabled = _gates[0].enabled();
+        _hp_filter.set_idle(gates_enabled && header.hp_filter_idle);
+        _interpolator.set_idle(gates_enabled && header.interpolator_idle);
+
+        _input_buffer_num = header.input_buffer_num;
+
+        return true;
+
+    }
+
+
+    SongFinderKernels kernels() {
+        return { _hp_filter.kernel(), _interpolator.kernel() };
+    }
+
+
+    // Sets where this processor and its buffers report events such as
+    // buffer overflows, for the processor of output channel `channel`,
+    // or of the pair of output channels starting with it.
+    // Diagnostics are reported without blocking, so this processor
+    // can be used on the audio render thread.
+    void set_diagnostics(DiagnosticsRing *diagnostics, uint16_t channel) {
+
+        _diagnostics = diagnostics;
+        _channel = channel;
+
+        const unsigned *block_num = &_input_buffer_num;
+        _block_input_buffer.set_diagnostics(
+            diagnostics, DiagnosticBuffer::BlockInput, channel, block_num);
+        _block_output_buffer.set_diagnostics(
+            diagnostics, DiagnosticBuffer::BlockOutput, channel, block_num);
+        _input_buffer.set_diagnostics(
+            diagnostics, DiagnosticBuffer::Input, channel, block_num);
+        _ola_buffer.set_diagnostics(
+            diagnostics, DiagnosticBuffer::OverlapAdder, channel, block_num);
+        _hp_buffer.set_diagnostics(
+            diagnostics, DiagnosticBuffer::Highpass, channel, block_num);
+        _output_buffer.set_diagnostics(
+            diagnostics, DiagnosticBuffer::Output, channel, block_num);
+
+    }
+
+
+    // Returns the number of zeros with which a processor primes its
+    // input when it is created. See the comment near the top of this
+    // file for why this is the minimum needed.
+    size_t minimum_priming_size() {
+        return _overlap_adder.window_size() - 1;
+    }
+
+
+    // Returns the processing block size, or zero if the stages process
+    // input blocks as the caller provides them.
+    size_t block_size() {
+        return _block_size;
+    }
+
+
+    SongFinderQuality quality() {
+        return _quality;
+    }
+
+
+    double sample_rate() {
+        return _sample_rate;
+    }
+
+
+    unsigned channel_count() {
+        return _channel_count;
+    }
+
+
+    // Returns `true` if this processor's activity gates are enabled and
+    // closed, so that the processor is idling. See `ActivityGate`.
+    bool idle() {
+
+        if (!_gates[0].enabled())
+            return false;
+
+        for (unsigned i = 0; i != _channel_count; ++i)
+            if (!_gates[i].idle())
+                return false;
+
+        return true;
+
+    }
+
+
+    // Returns `true` if this processor skipped its stages for its last
+    // input because it was silent.
+    //
+    // Once the input has been silent for long enough that nothing
+    // in the processor's state derives from sound, the output is silent
+    // for as long as the input stays silent, so the processor just
+    // writes zeros to its output, leaving its stages and buffers
+    // untouched. When sound resumes, the processor resumes exactly
+    // as if the skipped input had never been given to it. Its latency
+    // is unchanged, and its buffers hold silence, so its output is
+    // continuous.
+    bool silent() {
+        return _silent;
+    }
+
+
+    // Sets whether this processor skips its stages for silent input,
+    // which it does by default. With skipping off, the stages process
+    // silent input like any other, so that, for example, a benchmark
+    // can measure their cost as their state decays toward zero. Input
+    // given while skipping is off does not count toward the silence
+    // horizon once it is on again.
+    void set_silence_skipping(bool enabled) {
+        _silence_skipping = enabled;
+        for (size_t &silent_size : _silent_sizes)
+            silent_size = 0;
+        _silent = false;
+    }
+
+
+    // Returns the number of multiply-adds this processor performs per
+    // second of audio, a measure of its CPU cost that is independent
+    // of the machine it runs on. The overlap-adder performs one per
+    // input sample, the highpass filter one per tap per overlap-adder
+    // output sample, and the interpolator one per tap of one of its
+    // polyphase subfilters per output sample, for each channel.
+    double multiply_adds_per_second() {
+
+        const unsigned d = _pitch_shift_factor;
+        const size_t subfilter_length = (_interpolator.filter_length() + d - 1) / d;
+
+        double count = _sample_rate + _sample_rate * subfilter_length;
+
+        if (_cutoff != 0)
+            count += _sample_rate / d * _hp_filter.length();
+
+        return count * _channel_count;
+
+    }
+
+
+    // Returns the number of bytes of memory allocated by this
+    // processor, including its stages and buffers.
+    size_t memory_size() {
+        return sizeof(*this) + _window_type.capacity() +
+            _block_input_buffer.memory_size() +
+            _block_output_buffer.memory_size() +
+            _input_buffer.memory_size() + _ola_buffer.memory_size() +
+            _hp_buffer.memory_size() + _output_buffer.memory_size() +
+            _overlap_adder.memory_size() + _hp_filter.memory_size() +
+            _interpolator.memory_size() -
+            sizeof(_block_input_buffer) - sizeof(_block_output_buffer) -
+            sizeof(_input_buffer) - sizeof(_ola_buffer) -
+            sizeof(_hp_buffer) - sizeof(_output_buffer) -
+            sizeof(_overlap_adder) - sizeof(_hp_filter) -
+            sizeof(_interpolator);
+    }
+
+
+    // Returns the latency of this processor in frames.
+    //
+    // The processor time-stretches the contents of each overlap-add
+    // window by the pitch shift factor, so its delay is not the same
+    // for all input samples. The latency reported here is the delay
+    // of a window-aligned impulse, i.e. of a sample at the start of a
+    // window, which is the smallest delay of any sample. A sample `v`
+    // samples into a window is delayed by an additional
+    // `(pitch_shift_factor - 1) * v` samples, so other positions add
+    // up to `(D - 1) * (W - 1)` samples, where D is the pitch shift
+    // factor and W the window size in samples. Since the input is
+    // primed with W - 1 zeros, windows start at input samples 1,
+    // W + 1, 2W + 1, and so on.
+    //
+    // The latency is the sum of the number of priming samples, the
+    // group delay of the interpolation filter, the group delay of
+    // the highpass filter, if any, and the B - 1 samples of latency
+    // added by a processing block size B, if any. The highpass filter processes
+    // overlap-adder output, so its group delay is multiplied by the
+    // pitch shift factor. Both filters are linear-phase and of odd
+    // length, so their group delays are whole numbers of samples.
+    size_t latency() {
+
+        size_t latency = _priming_size + (_interpolator.filter_length() - 1) / 2;
+
+        if (_cutoff != 0)
+            latency += _pitch_shift_factor * (_hp_filter.length() - 1) / 2;
+
+        if (_block_size != 0)
+            latency += _block_size - 1;
+
+        return latency;
+
+    }
+
+
+    // Returns the number of input frames after which the output of a
+    // new or reset processor no longer includes the silence of the
+    // zeros it was primed with, but only the tails of the filter
+    // responses to them. This is the largest delay of any input sample,
+    // that of a sample at the end of an overlap-add window (see
+    // `latency`).
+    size_t warm_up_size() {
+        return latency() +
+            (_pitch_shift_factor - 1) * (_overlap_adder.window_size() - 1);
+    }
+
+
+
+    // Processes `input_count` input samples of a one-channel
+    // processor, writing the same number of output samples to
+    // `output`. See below.
+    void process(
+        const float *input, size_t input_count, float *output,
+        size_t input_stride = 1, size_t output_stride = 1) {
+        process(&input, input_count, &output, input_stride, output_stride);
+    }
+
+
+    // Processes `input_count` input frames, reading channel `i` from
+    // `inputs[i]` and writing the same number of output frames,
+    // channel `i` to `outputs[i]`. Without a processing block size,
+    // the final stage of the processor writes its output directly to
+    // `output`, except for any samples it produces beyond the end of
+    // `output`, which it keeps for the next call. Inputs larger than
+    // the max input size are processed in chunks of at most that size,
+    // so that the processor buffers stay within the sizes they were
+    // allocated with.
+    //
+    // Successive samples of each input channel are read `input_stride`
+    // floats apart, and of each output channel written `output_stride`
+    // floats apart, so that the input and output can be channels of
+    // interleaved audio. The processor reads each input sample once,
+    // into its first stage, and writes each output sample once, from
+    // its last.
+    void process(
+        const float *const *inputs, size_t input_count,
+        float *const *outputs, size_t input_stride = 1,
+        size_t output_stride = 1) {
+
+        if (input_count > _max_input_size) {
+            // input count exceeds max configured size
+
+            // A host that exceeds the max input size usually does so
+            // with every block, so post an event only when the size
+            // changes, and just count the others.
+            if (input_count != _oversize_size) {
+                _oversize_size = input_count;
+                _post(DiagnosticEventType::OversizeBlock,
+                      input_count, _max_input_size);
+            } else if (_diagnostics != nullptr) {
+                _diagnostics->tally(DiagnosticEventType::OversizeBlock);
+            }
+
+            const float *chunk_inputs[_max_channel_count];
+            float *chunk_outputs[_max_channel_count];
+            for (unsigned i = 0; i != _channel_count; ++i) {
+                chunk_inputs[i] = inputs[i];
+                chunk_outputs[i] = outputs[i];
+            }
+
+            while (input_count != 0) {
+                const size_t n = std::min(input_count, _max_input_size);
+                _process_chunk(
+                    chunk_inputs, n, chunk_outputs, input_stride,
+                    output_stride);
+                for (unsigned i = 0; i != _channel_count; ++i) {
+                    chunk_inputs[i] += n * input_stride;
+                    chunk_outputs[i] += n * output_stride;
+                }
+                input_count -= n;
+            }
+
+        } else {
+            // input count does not exceed max configured size
+
+            _process_chunk(
+                inputs, input_count, outputs, input_stride, output_stride);
+
+        }
 
     }
 
 
 private:
 
-    static const size_t _buffer_size = 50;    // _max_input_size units
+
+    static const size_t _buffer_count = 6;
+
+    static const unsigned _max_channel_count = 2;
+
+
+    // Header of a state snapshot, which is followed by the overlap-adder
+    // accumulator and then the contents of the buffers returned by
+    // `_get_buffers`, in order.
+    struct _State {
+
+        // configuration, which a restoring processor must match
+        size_t max_input_size;
+        size_t block_size;
+        SongFinderQuality quality;
+        unsigned cutoff;
+        unsigned pitch_shift_factor;
+        char window_type[32];
+        double window_size;
+        double sample_rate;
+        unsigned channel_count;
+
+        size_t buffer_sizes[_buffer_count];
+        ActivityGate::State gates[_max_channel_count];
+        size_t silent_sizes[_max_channel_count];
+        bool silent;
+        bool hp_filter_idle;
+        bool interpolator_idle;
+        unsigned input_buffer_num;
+
+    };
+
+
+    struct BufferSizes {
+        size_t block;
+        size_t input;
+        size_t ola;
+        size_t hp;
+        size_t output;
+    };
+
 
     size_t _max_input_size;
+    size_t _block_size;
+    SongFinderQuality _quality;
     unsigned _cutoff;
     unsigned _pitch_shift_factor;
     string _window_type;
     double _window_size;
+    double _sample_rate;
+    unsigned _channel_count;
 
+    BufferSizes _buffer_sizes;
+    AdvancingBuffer<float> _block_input_buffer;
+    AdvancingBuffer<float> _block_output_buffer;
     AdvancingBuffer<float> _input_buffer;
     AdvancingBuffer<float> _ola_buffer;
     AdvancingBuffer<float> _hp_buffer;
@@ -169,25 +717,504 @@ private:
     FirFilter _hp_filter;
     Interpolator _interpolator;
 
+    // one per channel, only the first `_channel_count` of which are used
+    ActivityGate _gates[_max_channel_count];
+
+    size_t _priming_size;
+
+    // number of consecutive silent input frames after which nothing
+    // in the processor's state derives from sound
+    size_t _silence_horizon;
+
+    // number of consecutive silent input samples received, per channel
+    size_t _silent_sizes[_max_channel_count];
+
+    bool _silent;
+
+    // whether to skip silence at all. See `set_silence_skipping`.
+    bool _silence_skipping;
+
+    DiagnosticsRing *_diagnostics;
+    uint16_t _channel;
     unsigned _input_buffer_num;
 
+    // size of the last oversize input block posted as an
+    // `OversizeBlock` event, or zero if there has been none
+    size_t _oversize_size;
+
+
+    // Processes an input chunk of at most the max input size.
+    void _process_chunk(
+        const float *const *inputs, size_t input_count,
+        float *const *outputs, size_t input_stride, size_t output_stride) {
+
+        _silent = _skip_silence(
+            inputs, input_count, outputs, input_stride, output_stride);
+
+        if (_silent) {
+            // input silent and state flushed
+
+            // Leave the stages and buffers as they are.
 
+        } else if (_block_size == 0) {
+            // processing input blocks as provided
+
+            _process_stages(
+                inputs, input_count, outputs, input_stride, output_stride);
+
+        } else {
+            // processing fixed-size blocks
+
+            const size_t channel_count = _channel_count;
+            const size_t block_size = _block_size * channel_count;
+
+            _append_input(
+                _block_input_buffer, inputs, input_count, input_stride);
+
+            while (_block_input_buffer.size() >= block_size) {
+                const float *block_input = _block_input_buffer.data();
+                float *block_output = _block_output_buffer.extend(block_size);
+                const float *const block_inputs[_max_channel_count] =
+                    { block_input, block_input + 1 };
+                float *const block_outputs[_max_channel_count] =
+                    { block_output, block_output + 1 };
+                _process_stages(
+                    block_inputs, _block_size, block_outputs,
+                    channel_count, channel_count);
+                _block_input_buffer.discard(block_size);
+            }
+
+            // Thanks to the priming done by the constructor, the block
+            // output buffer always has enough frames for this.
+            _copy_output(
+                _block_output_buffer.data(), input_count, outputs,
+                output_stride);
+            _block_output_buffer.discard(input_count * channel_count);
+
+        }
+
+        _input_buffer_num += 1;
+
+    }
+
+
+    // Processes `input_count` input samples through all stages,
+    // writing the same number of output samples to `output`. The final
+    // stage writes its output directly to `output`, except for any
+    // samples it produces beyond the end of `output`, which it keeps
+    // for the next call.
+    //
+    // With the activity gate enabled, the highpass filter and the
+    // interpolator idle while the gate is closed, which eliminates
+    // almost all of the processing cost. The overlap-adder, which is
+    // cheap, keeps running so that its state is always current, and
+    // the idle highpass filter keeps its input history. The processor
+    // thus resumes exactly as if it had never idled, except that the
+    // interpolator history holds zeros rather than the insignificant
+    // highpass filter output computed from sub-threshold input.
+    void _process_stages(
+        const float *const *inputs, size_t input_count,
+        float *const *outputs, size_t input_stride, size_t output_stride) {
+
+        const size_t channel_count = _channel_count;
+
+        _append_input(_input_buffer, inputs, input_count, input_stride);
+
+        // The gates measure the input from the input buffer, where it
+        // is contiguous. Every gate is updated, and the stages idle
+        // only if all of them are closed.
+        if (_gates[0].enabled()) {
+            const float *data = _input_buffer.data() +
+                _input_buffer.size() - input_count * channel_count;
+            bool active = false;
+            for (size_t i = 0; i != channel_count; ++i)
+                if (_gates[i].update(data + i, input_count, channel_count))
+                    active = true;
+            _hp_filter.set_idle(!active);
+            _interpolator.set_idle(!active);
+        }
+
+        // Process input through all stages but the last.
+        _overlap_adder.process();
+        if (_cutoff != 0)
+            _hp_filter.process();
+
+        // Copy output left over from previous calls to output arrays.
+        size_t output_count = _output_buffer.size() / channel_count;
+        if (output_count > input_count)
+            output_count = input_count;
+        if (output_count != 0) {
+            _copy_output(
+                _output_buffer.data(), output_count, outputs, output_stride);
+            _output_buffer.discard(output_count * channel_count);
+        }
+
+        // Interpolate directly into rest of output arrays. Thanks to
+        // the priming done by the constructor, this always fills them.
+        float *rest[_max_channel_count];
+        for (size_t i = 0; i != channel_count; ++i)
+            rest[i] = outputs[i] + output_count * output_stride;
+        _interpolator.process(
+            rest, input_count - output_count, output_stride);
+
+        if (_gates[0].enabled())
+            for (size_t i = 0; i != channel_count; ++i)
+                _gates[i].process(outputs[i], input_count, output_stride);
+
+    }
+
+
+    // Measures the peak magnitude of each channel of an input chunk,
+    // and if every channel of the chunk is silent and the channel was
+    // already silent for the silence horizon before it, writes zeros
+    // to the output and returns `true`.
+    bool _skip_silence(
+        const float *const *inputs, size_t input_count,
+        float *const *outputs, size_t input_stride, size_t output_stride) {
+
+        if (!_silence_skipping)
+            return false;
+
+        bool flushed = true;
+
+        for (unsigned j = 0; j != _channel_count; ++j) {
+
+            const float *input = inputs[j];
+            float peak = 0;
+            for (size_t i = 0; i != input_count; ++i) {
+                const float magnitude = std::fabs(input[i * input_stride]);
+                peak = magnitude > peak ? magnitude : peak;
+            }
+
+            if (peak >= silence_threshold) {
+                _silent_sizes[j] = 0;
+                flushed = false;
+            } else {
+                if (_silent_sizes[j] < _silence_horizon)
+                    flushed = false;
+                _silent_sizes[j] += input_count;
+            }
+
+        }
+
+        if (!flushed)
+            return false;
+
+        for (unsigned j = 0; j != _channel_count; ++j) {
+            float *output = outputs[j];
+            if (output_stride == 1)
+                std::memset(output, 0, input_count * sizeof(float));
+            else
+                for (size_t i = 0; i != input_count; ++i)
+                    output[i * output_stride] = 0;
+        }
+
+        return true;
+
+    }
+
+
+    std::array<AdvancingBuffer<float> *, _buffer_count> _get_buffers() {
+        return {
+            &_block_input_buffer, &_block_output_buffer, &_input_buffer,
+            &_ola_buffer, &_hp_buffer, &_output_buffer
+        };
+    }
+
+
+    // Returns `true` if a state snapshot is of a processor with the
+    // same configuration as this one.
+    bool _matches(const _State &state) {
+        return state.max_input_size == _max_input_size &&
+            state.block_size == _block_size &&
+            state.quality == _quality &&
+            state.cutoff == _cutoff &&
+            state.pitch_shift_factor == _pitch_shift_factor &&
+            std::strncmp(
+                state.window_type, _window_type.c_str(),
+                sizeof(state.window_type)) == 0 &&
+            state.window_size == _window_size &&
+            state.sample_rate == _sample_rate &&
+            state.channel_count == _channel_count;
+    }
+
+
+    // Appends `count` input frames to `buffer`, interleaving their
+    // channels.
+    void _append_input(
+        AdvancingBuffer<float> &buffer, const float *const *inputs,
+        size_t count, size_t input_stride) {
+
+        if (_channel_count == 1) {
+            buffer.append(inputs[0], count, input_stride);
+            return;
+        }
+
+        const float *input0 = inputs[0];
+        const float *input1 = inputs[1];
+        float *data = buffer.extend(2 * count);
+        for (size_t i = 0; i != count; ++i) {
+            data[2 * i] = input0[i * input_stride];
+            data[2 * i + 1] = input1[i * input_stride];
+        }
+
+    }
+
+
+    // Copies `count` interleaved frames from `data` to `outputs`,
+    // deinterleaving their channels.
+    void _copy_output(
+        const float *data, size_t count, float *const *outputs,
+        size_t output_stride) {
+
+        const size_t channel_count = _channel_count;
+
+        for (size_t j = 0; j != channel_count; ++j) {
+            float *output = outputs[j];
+            if (channel_count == 1 && output_stride == 1)
+                std::memcpy(output, data, count * sizeof(float));
+            else
+                for (size_t i = 0; i != count; ++i)
+                    output[i * output_stride] = data[i * channel_count + j];
+        }
+
+    }
+
+
+    void _post(DiagnosticEventType type, size_t value, size_t limit) {
+        if (_diagnostics != nullptr)
+            _diagnostics->post({
+                type, DiagnosticBuffer::None, _channel, _input_buffer_num,
+                value, limit });
+    }
+
+
+    // Computes the buffer sizes derived in the comment near the top
+    // of this file. This is called before any buffers or stages are
+    // constructed, so it uses only configuration members.
+    BufferSizes _get_buffer_sizes() {
+
+        const unsigned d = _pitch_shift_factor;
+        const size_t s = OverlapAdder::get_segment_size(
+            d, _window_size, _sample_rate);
+        const size_t w = d * s;
+        const size_t m = _block_size != 0 ? _block_size : _max_input_size;
+        const size_t k = (w - 1 + m) / w;
+        const size_t r = Interpolator::get_input_record_size(
+            _get_interpolator_filter_coeffs(d, _quality).size(), d);
+
+        const size_t c = _channel_count;
+
+        BufferSizes sizes;
+
+        sizes.block =
+            _block_size != 0 ? (_block_size - 1 + _max_input_size) * c : 0;
+
+        sizes.input = (w - 1 + m) * c;
+
+        if (_cutoff == 0) {
+            sizes.ola = (r - 1 + k * s) * c;
+            sizes.hp = 0;
+        } else {
+            const size_t l =
+                _get_hp_filter_coeffs(_cutoff, _quality, _sample_rate).size();
+            sizes.ola = (l - 1 + k * s) * c;
+            sizes.hp = (r - 1 + k * s) * c;
+        }
+
+        sizes.output = (w + d - 2) * c;
+
+        return sizes;
+
+    }
+
+
+    // Returns a bound on the number of input samples after which an
+    // input sample no longer influences anything in the processor's
+    // state. Per the `latency` comment, a sample `v` samples into an
+    // overlap-adder window reaches the middle of the filters after the
+    // latency plus `(pitch_shift_factor - 1) * v` samples. We add the
+    // full filter lengths, the highpass filter's in input samples, and
+    // one more window for good measure.
+    size_t _get_silence_horizon() {
+
+        const size_t d = _pitch_shift_factor;
+        const size_t w = _overlap_adder.window_size();
+
+        size_t horizon =
+            latency() + (d - 1) * (w - 1) + _interpolator.filter_length() + w;
+
+        if (_cutoff != 0)
+            horizon += d * _hp_filter.length();
+
+        return horizon;
+
+    }
+
+
+    void _prime_input(size_t frame_count) {
+        _input_buffer.append_zeros(frame_count * _channel_count);
+        _priming_size += frame_count;
+    }
+
+
+};
+
+
+// Filter specifications
+//
+// The `Standard` quality tier uses the precomputed equiripple filters
+// of `HbaFilters.hpp`. Their highpass filters have a 400 Hz transition
+// band below the cutoff, and their interpolation filters a transition
+// band one quarter the width of the interpolator input band, ending at
+// the input Nyquist frequency. All have 60 dB of stopband attenuation.
+//
+// The other tiers relax some of those specifications and design the
+// relaxed filters at run time (see `FilterDesign.hpp`):
+//
+//     tier        highpass                    interpolation
+//                 transition  atten.  taps    transition  atten.  taps
+//     Standard    400 Hz      60 dB   299     1/4         60 dB   43-85
+//     Balanced    750 Hz      50 dB   199     1/4         60 dB   43-85
+//     Economy     1000 Hz     40 dB   115     2/5         40 dB   25-49
+//
+// Highpass filter lengths are for a 2000 Hz cutoff, and interpolation
+// filter lengths for pitch shift factors of two through four. The
+// highpass filter dominates the cost of processing, so with a pitch
+// shift factor of two the Balanced and Economy tiers cost about 70
+// and 40 percent as much as the Standard tier. (See
+// `SongFinderProcessor::multiply_adds_per_second`.) Attenuations are
+// minimums. The Kaiser window designs are a few dB short of their
+// targets at the band edges, so the targets include a margin.
+//
+// The precomputed highpass filters are for a sample rate of 48 kHz. At
+// other sample rates the highpass filters of all tiers are designed at
+// run time, including a Kaiser window design of the Standard tier's
+// specification. Above 48 kHz the transition widths are scaled in
+// proportion to the sample rate, up to half the cutoff, so that the
+// filters have about as many taps as at 48 kHz rather than growing
+// with the sample rate. Designed highpass filters are cached,
+// since all of the processors of a set, and the tuner, use the same
+// ones. The interpolation filters' band edges are fractions of the
+// sample rate, so they are the same at all sample rates.
+
+
+struct _FilterSpec {
+    double hp_transition_width;         // Hz
+    double interpolator_transition;     // fraction of input band, or zero
+                                        // for the Standard filter
+    double attenuation;                 // dB, design target
+};
+
+
+const map<SongFinderQuality, _FilterSpec> _filter_specs {
+    { SongFinderQuality::Standard, { 400, 0, 62 } },
+    { SongFinderQuality::Balanced, { 750, 0, 52 } },
+    { SongFinderQuality::Economy, { 1000, .4, 42 } }
 };
 
 
 const vector<float> dummy_filter { 1 };
 
 
-vector<float> _get_hp_filter_coeffs(unsigned cutoff) {
+// Kinds of filters designed to the specifications of quality tiers.
+enum class _DesignedFilterType {
+    Highpass,
+    Interpolator
+};
+
+
+vector<float> _design_hp_filter(
+    unsigned cutoff, SongFinderQuality quality, double sample_rate) {
+
+    // Scale the transition width with the sample rate above 48 kHz, but
+    // not so much that the stopband shrinks to less than half of the
+    // band below the cutoff.
+    const _FilterSpec &spec = _filter_specs.at(quality);
+    const double scale = std::max(
+        1., sample_rate / SongFinderProcessor::standard_sample_rate);
+    const double transition_width = std::min(
+        spec.hp_transition_width * scale,
+        std::max(spec.hp_transition_width, cutoff / 2.));
+
+    return design_highpass(
+        cutoff - transition_width, cutoff, spec.attenuation, sample_rate);
+
+}
+
+
+// Designs an unscaled interpolation filter, i.e. one with unity gain.
+vector<float> _design_interpolator_filter(
+    unsigned shift, SongFinderQuality quality) {
+
+    const _FilterSpec &spec = _filter_specs.at(quality);
+    const double sample_rate = SongFinderProcessor::standard_sample_rate;
+    const double stop_edge = sample_rate / (2 * shift);
+    const double pass_edge = stop_edge * (1 - spec.interpolator_transition);
+
+    return design_lowpass(pass_edge, stop_edge, spec.attenuation, sample_rate);
+
+}
+
+
+// Returns a filter designed to the specification of a quality tier,
+// designing it only the first time it is requested. `parameter` is the
+// cutoff of a highpass filter or the pitch shift factor of an
+// interpolation filter.
+vector<float> _get_designed_filter_coeffs(
+    _DesignedFilterType type, unsigned parameter, SongFinderQuality quality,
+    double sample_rate) {
+
+    typedef tuple<_DesignedFilterType, unsigned, SongFinderQuality, double> Key;
+    static map<Key, vector<float>> filters;
+    static std::mutex mutex;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const Key key(type, parameter, quality, sample_rate);
+    auto i = filters.find(key);
+    if (i != filters.end())
+        return i->second;
+
+    const vector<float> filter = type == _DesignedFilterType::Highpass ?
+        _design_hp_filter(parameter, quality, sample_rate) :
+        _design_interpolator_filter(parameter, quality);
+    filters[key] = filter;
+    return filter;
+
+}
+
+
+vector<float> _get_hp_filter_coeffs(
+    unsigned cutoff, SongFinderQuality quality, double sample_rate) {
+
     if (cutoff == 0)
         return dummy_filter;
-    else
+
+    else if (quality == SongFinderQuality::Standard &&
+            sample_rate == SongFinderProcessor::standard_sample_rate)
         return highpass_filters.at(cutoff);
+
+    else
+        return _get_designed_filter_coeffs(
+            _DesignedFilterType::Highpass, cutoff, quality, sample_rate);
+
 }
 
 
-vector<float> _get_interpolator_filter_coeffs(unsigned shift) {
-    const vector<float> unscaled_filter = lowpass_filters.at(shift);
+vector<float> _get_interpolator_filter_coeffs(
+    unsigned shift, SongFinderQuality quality) {
+
+    // Interpolation filters are designed for the standard sample rate,
+    // since they depend only on the pitch shift factor.
+    const vector<float> unscaled_filter =
+        quality == SongFinderQuality::Standard ||
+                _filter_specs.at(quality).interpolator_transition == 0 ?
+            lowpass_filters.at(shift) :
+            _get_designed_filter_coeffs(
+                _DesignedFilterType::Interpolator, shift, quality,
+                SongFinderProcessor::standard_sample_rate);
+
     const size_t filter_length = unscaled_filter.size();
     vector<float> scaled_filter(filter_length);
     for (size_t i = 0; i != filter_length; ++i)
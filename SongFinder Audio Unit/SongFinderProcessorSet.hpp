@@ -0,0 +1,250 @@
+#ifndef SongFinderProcessorSet_hpp
+#define SongFinderProcessorSet_hpp
+
+
+#import <AudioToolbox/AudioToolbox.h>
+#import <algorithm>
+#import <string>
+#import "DiagnosticsRing.hpp"
+#import "SongFinderProcessor.hpp"
+#import "SongFinderTuner.hpp"
+
+
+// The parameters of a `SongFinderDSPKernel` that can be changed only
+// by building new processors.
+struct SongFinderConfig {
+    AUValue cutoff = 0;         // Hz
+    AUValue pitchShift = 2;
+    AUValue windowType = 0;
+    AUValue windowSize = 20;    // ms
+    AUValue quality = 0;        // `SongFinderQuality` index
+
+    // Processing block size in samples, or zero to process blocks as
+    // the host provides them. Larger blocks lower CPU usage at small
+    // host block sizes, at the cost of `blockSize - 1` samples of
+    // additional latency.
+    unsigned blockSize = 0;
+
+    // Whether the processors idle while their input has no energy above
+    // the cutoff, and the band power in dBFS above which they resume.
+    // See `ActivityGate`.
+    bool activityGate = false;
+    float activityGateThreshold = -60;
+};
+
+
+// A set of SongFinder processors for the processed input channels,
+// all with the same configuration.
+//
+// The channels are processed in pairs, each by one two-channel
+// processor, which is cheaper than two one-channel processors since
+// it loads each filter coefficient once for both channels. (See the
+// comment near the top of `SongFinderProcessor.hpp`.) Processor `p`
+// processes channels `2 * p` and `2 * p + 1`, except that with an odd
+// number of channels the last processor processes only the last
+// channel.
+//
+// Processor sets are built off the render thread, handed to the
+// render thread, and eventually handed back to be deleted, so that
+// the render thread never allocates or frees memory.
+class SongFinderProcessorSet {
+
+
+public:
+
+
+    SongFinderProcessorSet(
+
+        int channelCount,
+        const SongFinderConfig &config,
+        double sampleRate,
+        size_t maxInputSize,
+        SongFinderTuner &tuner,
+        DiagnosticsRing *diagnostics
+
+    ) :
+
+        _channelCount(channelCount),
+        _processorCount((channelCount + 1) / 2),
+        _config(config)
+
+    {
+
+        const std::string windowType =
+            config.windowType == 0 ? "Hann" : "SongFinder";
+        const double windowSize = config.windowSize / 1000;
+        const unsigned cutoff = config.cutoff;
+        const unsigned pitchShift = config.pitchShift;
+        const SongFinderQuality quality =
+            config.quality < 1 ? SongFinderQuality::Standard :
+            config.quality < 2 ? SongFinderQuality::Balanced :
+            SongFinderQuality::Economy;
+
+        // Get the fastest stage implementations for this configuration.
+        // This measures them the first time a configuration is seen on
+        // this machine, so it must not happen on the render thread.
+        // They are measured for the processors of channel pairs, since
+        // with more than one channel those do most of the work.
+        const SongFinderKernels kernels = tuner.kernels(
+            cutoff, pitchShift, windowSize,
+            config.blockSize != 0 ? config.blockSize : maxInputSize,
+            quality, sampleRate, std::min(_channelCount, 2));
+
+        ActivityGateSettings gateSettings;
+        gateSettings.enabled = config.activityGate;
+        gateSettings.open_threshold = config.activityGateThreshold;
+
+        // Each processor primes itself with the minimum number of zeros
+        // needed to always produce as much output as it gets input.
+        _processors = new SongFinderProcessor*[_processorCount];
+        for (int i = 0; i != _processorCount; ++i) {
+            const int firstChannel = 2 * i;
+            const unsigned processorChannelCount =
+                std::min(_channelCount - firstChannel, 2);
+            _processors[i] = new SongFinderProcessor(
+                maxInputSize, cutoff, pitchShift, windowType, windowSize,
+                kernels, config.blockSize, quality, gateSettings, sampleRate,
+                processorChannelCount);
+            _processors[i]->set_diagnostics(diagnostics, firstChannel);
+        }
+
+    }
+
+
+    ~SongFinderProcessorSet() {
+        for (int i = 0; i != _processorCount; ++i)
+            delete _processors[i];
+        delete[] _processors;
+    }
+
+
+    SongFinderProcessorSet(const SongFinderProcessorSet &) = delete;
+    SongFinderProcessorSet &operator=(const SongFinderProcessorSet &) = delete;
+
+
+    // Returns the number of channels processed by this set.
+    int channelCount() const {
+        return _channelCount;
+    }
+
+
+    int processorCount() const {
+        return _processorCount;
+    }
+
+
+    const SongFinderConfig &config() const {
+        return _config;
+    }
+
+
+    SongFinderProcessor *processor(int i) const {
+        return _processors[i];
+    }
+
+
+    // Returns the first channel processed by processor `i`.
+    int firstChannel(int i) const {
+        return 2 * i;
+    }
+
+
+    // Resets all of the processors of this set. See
+    // `SongFinderProcessor::reset`.
+    void reset() {
+        for (int i = 0; i != _processorCount; ++i)
+            _processors[i]->reset();
+    }
+
+
+    // Returns the size in bytes of a snapshot of the states of all of
+    // the processors of this set. See `SongFinderProcessor::save_state`.
+    size_t stateSize() const {
+        size_t size = 0;
+        for (int i = 0; i != _processorCount; ++i)
+            size += _processors[i]->state_size();
+        return size;
+    }
+
+
+    // Writes a snapshot of the states of all of the processors of this
+    // set to `state`, which must have room for `stateSize()` bytes.
+    void saveState(void *state) const {
+        char *bytes = static_cast<char *>(state);
+        for (int i = 0; i != _processorCount; ++i) {
+            _processors[i]->save_state(bytes);
+            bytes += _processors[i]->state_size();
+        }
+    }
+
+
+    // Restores a snapshot of `size` bytes written by `saveState`.
+    // Returns `false`, leaving the processors unchanged, if the
+    // snapshot is of a set with a different number of processors or a
+    // different configuration.
+    bool restoreState(const void *state, size_t size) {
+
+        if (size != stateSize())
+            return false;
+
+        // All of the processors have the same configuration, so if the
+        // first restores, they all do.
+        const char *bytes = static_cast<const char *>(state);
+        for (int i = 0; i != _processorCount; ++i) {
+            if (!_processors[i]->restore_state(bytes))
+                return false;
+            bytes += _processors[i]->state_size();
+        }
+
+        return true;
+
+    }
+
+
+    AUAudioFrameCount latencyFrames() const {
+        if (_processorCount != 0)
+            return static_cast<AUAudioFrameCount>(_processors[0]->latency());
+        else
+            return 0;
+    }
+
+
+    // See `SongFinderProcessor::warm_up_size`.
+    AUAudioFrameCount warmUpFrames() const {
+        if (_processorCount != 0)
+            return static_cast<AUAudioFrameCount>(_processors[0]->warm_up_size());
+        else
+            return 0;
+    }
+
+
+    // Returns the number of filter multiply-adds per second of all of
+    // the processors of this set.
+    double multiplyAddsPerSecond() const {
+        double count = 0;
+        for (int i = 0; i != _processorCount; ++i)
+            count += _processors[i]->multiply_adds_per_second();
+        return count;
+    }
+
+
+    size_t memorySize() const {
+        size_t size = sizeof(*this) + _processorCount * sizeof(*_processors);
+        for (int i = 0; i != _processorCount; ++i)
+            size += _processors[i]->memory_size();
+        return size;
+    }
+
+
+private:
+
+    int _channelCount;
+    int _processorCount;
+    SongFinderConfig _config;
+    SongFinderProcessor **_processors;
+
+
+};
+
+
+#endif
@@ -0,0 +1,519 @@
+#ifndef SONG_FINDER_TUNER
+#define SONG_FINDER_TUNER
+
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "AdvancingBuffer.hpp"
+#include "FirFilter.hpp"
+#include "Interpolator.hpp"
+#include "SongFinderProcessor.hpp"
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+
+using std::map;
+using std::string;
+using std::tuple;
+using std::vector;
+
+
+// Chooses the fastest inner loop implementations for the stages of a
+// `SongFinderProcessor` with a given configuration.
+//
+// The tuner times each candidate implementation of each stage on
+// synthetic input shaped like what the stage sees in the processor,
+// and remembers the winners. Winners are cached in memory and, if a
+// profile path is set, in a small text file so that later runs on
+// the same machine need not repeat the measurements. Each line of
+// the file has the form:
+//
+//     <CPU model>\t<cutoff> <shift> <window size> <block size> <quality> <sample rate> <channel count>\t<FIR kernel> <interpolator kernel>
+//
+// Lines for other CPU models are preserved but otherwise ignored, and
+// lines with an unrecognized form are dropped.
+//
+// Tuning takes on the order of tens of milliseconds per configuration,
+// so the `kernels` method must not be called on the audio render
+// thread.
+//
+// For reproducible benchmarking, the choice can be overridden with
+// the `set_override` method or the `SONG_FINDER_KERNELS` environment
+// variable, whose value is "direct", "optimized", or a FIR kernel
+// name and an interpolator kernel name separated by a comma, e.g.
+// "blocked,direct". An override disables measurement altogether.
+
+
+class SongFinderTuner {
+
+
+public:
+
+
+    static constexpr const char *override_variable_name = "SONG_FINDER_KERNELS";
+
+
+    SongFinderTuner() :
+        _cpu_model(_get_cpu_model()),
+        _has_override(false)
+    {
+        const char *value = std::getenv(override_variable_name);
+        if (value != nullptr)
+            set_override(value);
+    }
+
+
+    string cpu_model() {
+        return _cpu_model;
+    }
+
+
+    void set_profile_path(const string &profile_path) {
+        _profile_path = profile_path;
+        _load_profile();
+    }
+
+
+    // Sets a kernel override from a string of the form described
+    // above. Returns `false` and leaves any current override in place
+    // if the string is not recognized. An empty string clears the
+    // override.
+    bool set_override(const string &spec) {
+
+        if (spec.empty()) {
+            _has_override = false;
+            return true;
+        }
+
+        SongFinderKernels kernels;
+
+        if (spec == "direct") {
+            kernels = SongFinderKernels();
+
+        } else if (spec == "optimized") {
+            kernels.fir = FirKernel::Blocked;
+            kernels.interpolator = InterpolatorKernel::Polyphase;
+
+        } else {
+
+            const size_t comma = spec.find(',');
+            if (comma == string::npos ||
+                    !_parse_fir_kernel(spec.substr(0, comma), kernels.fir) ||
+                    !_parse_interpolator_kernel(
+                        spec.substr(comma + 1), kernels.interpolator))
+                return false;
+
+        }
+
+        _override = kernels;
+        _has_override = true;
+        return true;
+
+    }
+
+
+    SongFinderKernels kernels(
+
+        unsigned cutoff,
+        unsigned pitch_shift_factor,
+        double window_size,
+        size_t block_size,
+        SongFinderQuality quality = SongFinderQuality::Standard,
+        double sample_rate = SongFinderProcessor::standard_sample_rate,
+        unsigned channel_count = 1
+
+    ) {
+
+        if (_has_override)
+            return _override;
+
+        const Key key = _make_key(
+            cutoff, pitch_shift_factor, window_size, block_size, quality,
+            sample_rate, channel_count);
+
+        auto i = _winners.find(key);
+        if (i != _winners.end())
+            return i->second;
+
+        SongFinderKernels kernels;
+        kernels.fir = _tune_fir(
+            cutoff, pitch_shift_factor, window_size, quality, sample_rate,
+            channel_count);
+        kernels.interpolator = _tune_interpolator(
+            pitch_shift_factor, window_size, quality, sample_rate,
+            channel_count);
+
+        _winners[key] = kernels;
+        _save_profile();
+
+        return kernels;
+
+    }
+
+
+private:
+
+
+    // cutoff, pitch shift factor, window size in microseconds, block
+    // size, quality tier, sample rate in hertz, processor channel count
+    typedef tuple<
+        unsigned, unsigned, unsigned, size_t, unsigned, unsigned, unsigned> Key;
+
+    // The number of times each candidate is timed. We keep the
+    // minimum time, which is the least affected by preemption.
+    static const unsigned _trial_count = 5;
+
+    // The number of stage input segments processed per trial.
+    static const unsigned _segments_per_trial = 50;
+
+    string _cpu_model;
+    string _profile_path;
+    map<Key, SongFinderKernels> _winners;
+    bool _has_override;
+    SongFinderKernels _override;
+
+
+    static Key _make_key(
+        unsigned cutoff, unsigned pitch_shift_factor, double window_size,
+        size_t block_size, SongFinderQuality quality, double sample_rate,
+        unsigned channel_count) {
+
+        const unsigned window_size_us =
+            static_cast<unsigned>(round(window_size * 1e6));
+
+        return Key(
+            cutoff, pitch_shift_factor, window_size_us, block_size,
+            static_cast<unsigned>(quality),
+            static_cast<unsigned>(round(sample_rate)), channel_count);
+
+    }
+
+
+    // Returns the number of frames that the overlap-adder of a
+    // processor outputs per window, i.e. the size of the chunks in
+    // which the later stages receive their input.
+    static size_t _get_segment_size(
+        unsigned pitch_shift_factor, double window_size, double sample_rate) {
+
+        return OverlapAdder::get_segment_size(
+            pitch_shift_factor, window_size, sample_rate);
+
+    }
+
+
+    static vector<float> _create_test_signal(size_t size) {
+
+        // Use a simple deterministic pseudorandom sequence, so the
+        // timings do not depend on a library random number generator.
+        vector<float> signal(size);
+        unsigned state = 1;
+        for (size_t i = 0; i != size; ++i) {
+            state = state * 1664525u + 1013904223u;
+            signal[i] = static_cast<float>(state >> 8) / (1 << 24) - .5f;
+        }
+        return signal;
+
+    }
+
+
+    template <class Stage>
+    static double _time_stage(
+        Stage &stage, AdvancingBuffer<float> &input_buffer,
+        AdvancingBuffer<float> &output_buffer, const vector<float> &segment) {
+
+        double min_time = 0;
+
+        for (unsigned i = 0; i != _trial_count; ++i) {
+
+            const auto start_time = std::chrono::steady_clock::now();
+
+            for (unsigned j = 0; j != _segments_per_trial; ++j) {
+                input_buffer.append(segment.data(), segment.size());
+                stage.process();
+                output_buffer.discard(output_buffer.size());
+            }
+
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start_time;
+
+            if (i == 0 || elapsed.count() < min_time)
+                min_time = elapsed.count();
+
+        }
+
+        return min_time;
+
+    }
+
+
+    // The tuning methods below time stages of `channel_count` channels,
+    // on interleaved test segments of one overlap-adder window's output.
+
+    static FirKernel _tune_fir(
+        unsigned cutoff, unsigned pitch_shift_factor, double window_size,
+        SongFinderQuality quality, double sample_rate,
+        unsigned channel_count) {
+
+        // A processor with a zero cutoff has no highpass filter.
+        if (cutoff == 0)
+            return FirKernel::Direct;
+
+        const vector<float> coeffs =
+            _get_hp_filter_coeffs(cutoff, quality, sample_rate);
+        const vector<float> segment = _create_test_signal(
+            _get_segment_size(pitch_shift_factor, window_size, sample_rate) *
+            channel_count);
+        const size_t capacity =
+            coeffs.size() * channel_count + segment.size();
+
+        FirKernel winner = FirKernel::Direct;
+        double winner_time = 0;
+
+        for (FirKernel kernel : { FirKernel::Direct, FirKernel::Blocked }) {
+
+            AdvancingBuffer<float> input_buffer(capacity);
+            AdvancingBuffer<float> output_buffer(capacity);
+            FirFilter filter(
+                coeffs, input_buffer, output_buffer, kernel, channel_count);
+
+            const double time =
+                _time_stage(filter, input_buffer, output_buffer, segment);
+
+            if (kernel == FirKernel::Direct || time < winner_time) {
+                winner = kernel;
+                winner_time = time;
+            }
+
+        }
+
+        return winner;
+
+    }
+
+
+    static InterpolatorKernel _tune_interpolator(
+        unsigned pitch_shift_factor, double window_size,
+        SongFinderQuality quality, double sample_rate,
+        unsigned channel_count) {
+
+        const vector<float> filter =
+            _get_interpolator_filter_coeffs(pitch_shift_factor, quality);
+        const vector<float> segment = _create_test_signal(
+            _get_segment_size(pitch_shift_factor, window_size, sample_rate) *
+            channel_count);
+        const size_t capacity =
+            (filter.size() * channel_count + segment.size()) *
+            pitch_shift_factor;
+
+        InterpolatorKernel winner = InterpolatorKernel::Direct;
+        double winner_time = 0;
+
+        for (InterpolatorKernel kernel :
+                { InterpolatorKernel::Direct, InterpolatorKernel::Polyphase }) {
+
+            AdvancingBuffer<float> input_buffer(capacity);
+            AdvancingBuffer<float> output_buffer(capacity);
+            Interpolator interpolator(
+                pitch_shift_factor, filter, input_buffer, output_buffer,
+                kernel, channel_count);
+
+            const double time = _time_stage(
+                interpolator, input_buffer, output_buffer, segment);
+
+            if (kernel == InterpolatorKernel::Direct || time < winner_time) {
+                winner = kernel;
+                winner_time = time;
+            }
+
+        }
+
+        return winner;
+
+    }
+
+
+    static string _fir_kernel_name(FirKernel kernel) {
+        return kernel == FirKernel::Blocked ? "blocked" : "direct";
+    }
+
+
+    static bool _parse_fir_kernel(const string &name, FirKernel &kernel) {
+
+        if (name == "direct")
+            kernel = FirKernel::Direct;
+        else if (name == "blocked")
+            kernel = FirKernel::Blocked;
+        else
+            return false;
+
+        return true;
+
+    }
+
+
+    static string _interpolator_kernel_name(InterpolatorKernel kernel) {
+        return kernel == InterpolatorKernel::Polyphase ? "polyphase" : "direct";
+    }
+
+
+    static bool _parse_interpolator_kernel(
+        const string &name, InterpolatorKernel &kernel) {
+
+        if (name == "direct")
+            kernel = InterpolatorKernel::Direct;
+        else if (name == "polyphase")
+            kernel = InterpolatorKernel::Polyphase;
+        else
+            return false;
+
+        return true;
+
+    }
+
+
+    void _load_profile() {
+
+        std::ifstream file(_profile_path);
+        string line;
+
+        while (std::getline(file, line)) {
+
+            const size_t tab1 = line.find('\t');
+            const size_t tab2 = line.find('\t', tab1 + 1);
+
+            if (tab1 == string::npos || tab2 == string::npos ||
+                    line.substr(0, tab1) != _cpu_model)
+                continue;
+
+            std::istringstream key_stream(
+                line.substr(tab1 + 1, tab2 - tab1 - 1));
+            unsigned cutoff, shift, window_size_us, quality, sample_rate,
+                channel_count;
+            size_t block_size;
+            if (!(key_stream >> cutoff >> shift >> window_size_us >>
+                    block_size >> quality >> sample_rate >> channel_count))
+                continue;
+
+            std::istringstream value_stream(line.substr(tab2 + 1));
+            string fir_name, interpolator_name;
+            if (!(value_stream >> fir_name >> interpolator_name))
+                continue;
+
+            SongFinderKernels kernels;
+            if (!_parse_fir_kernel(fir_name, kernels.fir) ||
+                    !_parse_interpolator_kernel(
+                        interpolator_name, kernels.interpolator))
+                continue;
+
+            const Key key(
+                cutoff, shift, window_size_us, block_size, quality,
+                sample_rate, channel_count);
+            _winners[key] = kernels;
+
+        }
+
+    }
+
+
+    void _save_profile() {
+
+        if (_profile_path.empty())
+            return;
+
+        // Keep lines for other CPU models.
+        vector<string> lines;
+        {
+            std::ifstream file(_profile_path);
+            string line;
+            while (std::getline(file, line))
+                if (line.substr(0, line.find('\t')) != _cpu_model)
+                    lines.push_back(line);
+        }
+
+        for (const auto &[key, kernels] : _winners) {
+            const auto &[cutoff, shift, window_size_us, block_size, quality,
+                sample_rate, channel_count] = key;
+            std::ostringstream line;
+            line << _cpu_model << '\t' << cutoff << ' ' << shift << ' ' <<
+                window_size_us << ' ' << block_size << ' ' << quality << ' ' <<
+                sample_rate << ' ' << channel_count << '\t' <<
+                _fir_kernel_name(kernels.fir) << ' ' <<
+                _interpolator_kernel_name(kernels.interpolator);
+            lines.push_back(line.str());
+        }
+
+        // Failure to write the profile is not an error: we will just
+        // have to tune again next time.
+        std::ofstream file(_profile_path);
+        for (const string &line : lines)
+            file << line << '\n';
+
+    }
+
+
+    static string _get_cpu_model() {
+
+        string model;
+
+#ifdef __APPLE__
+
+        // On Macs `machdep.cpu.brand_string` names the processor. On
+        // iOS devices it may not exist, but `hw.machine` identifies
+        // the device model and hence the processor.
+        for (const char *name : { "machdep.cpu.brand_string", "hw.machine" }) {
+
+            size_t size = 0;
+
+            if (sysctlbyname(name, nullptr, &size, nullptr, 0) == 0 &&
+                    size != 0) {
+
+                vector<char> value(size);
+                if (sysctlbyname(name, value.data(), &size, nullptr, 0) == 0) {
+                    if (!model.empty())
+                        model += ' ';
+                    model += value.data();
+                }
+
+            }
+
+        }
+
+#else
+
+        std::ifstream file("/proc/cpuinfo");
+        string line;
+        while (std::getline(file, line)) {
+            if (line.compare(0, 10, "model name") == 0) {
+                const size_t colon = line.find(':');
+                if (colon != string::npos)
+                    model = line.substr(line.find_first_not_of(' ', colon + 1));
+                break;
+            }
+        }
+
+#endif
+
+        // Tabs separate the fields of profile lines.
+        for (char &c : model)
+            if (c == '\t' || c == '\n')
+                c = ' ';
+
+        return model.empty() ? "unknown" : model;
+
+    }
+
+
+};
+
+
+#endif
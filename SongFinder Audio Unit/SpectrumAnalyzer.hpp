@@ -0,0 +1,366 @@
+#ifndef SPECTRUM_ANALYZER
+#define SPECTRUM_ANALYZER
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "TapRing.hpp"
+#include "TripleBuffer.hpp"
+
+
+using std::size_t;
+using std::vector;
+
+
+// Spectra of the input and output of a processor at one time.
+struct SpectrumFrame {
+
+    // Magnitude spectra in dBFS, where a full scale sinusoid at a bin
+    // center frequency is zero dBFS.
+    vector<float> input;
+    vector<float> output;
+
+    // One more than the number of frames computed before this one, or
+    // zero if no frames have been computed.
+    uint64_t frame_num = 0;
+
+};
+
+
+// Computes spectra of audio tapped from the render thread for live
+// display, without computing anything on the render thread or making
+// the display wait on it.
+//
+// The render thread copies each block of one input channel and one
+// output channel into a `TapRing`, which is the only work it does for
+// the analyzer. A worker thread wakes up at the configured frame rate,
+// drains the ring, and computes windowed FFT magnitude spectra of the
+// most recent samples of each channel, discarding the rest. So the
+// spectra are decimated in time to the frame rate. The worker
+// publishes the spectra through a `TripleBuffer`, from which the
+// display reads the latest ones.
+//
+// The worker thread runs only while the analyzer is enabled, and the
+// render thread taps audio only while it is, so the analyzer costs
+// nothing when no one is looking at its spectra.
+
+
+class SpectrumAnalyzer {
+
+
+public:
+
+
+    // FFT size, which determines the frequency resolution. At 48 kHz
+    // the bins are 46.875 Hz apart.
+    static const size_t fft_size = 1024;
+
+    static const size_t bin_count = fft_size / 2 + 1;
+
+    static constexpr double min_frame_rate = 5;
+    static constexpr double max_frame_rate = 60;
+
+
+    SpectrumAnalyzer() :
+        _ring(2, _ring_capacity),
+        _frames(_create_frame()),
+        _input_history(fft_size),
+        _output_history(fft_size),
+        _read_buffers { vector<float>(fft_size), vector<float>(fft_size) },
+        _window(_create_window()),
+        _fft_data(fft_size),
+        _twiddles(fft_size / 2),
+        _bit_reversals(fft_size),
+        _enabled(false),
+        _frame_rate(30),
+        _stopping(false),
+        _frame_count(0)
+    {
+        _init_fft();
+    }
+
+
+    ~SpectrumAnalyzer() {
+        set_enabled(false);
+    }
+
+
+    SpectrumAnalyzer(const SpectrumAnalyzer &) = delete;
+    SpectrumAnalyzer &operator=(const SpectrumAnalyzer &) = delete;
+
+
+    // Starts or stops the worker thread and the render thread tap.
+    // Call from only one thread, not the render thread.
+    void set_enabled(bool enabled) {
+
+        if (enabled == _enabled.load(std::memory_order_relaxed))
+            return;
+
+        if (enabled) {
+            _stopping = false;
+            _worker = std::thread(&SpectrumAnalyzer::_run, this);
+            _enabled.store(true, std::memory_order_relaxed);
+        } else {
+            _enabled.store(false, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+            _condition.notify_one();
+            _worker.join();
+        }
+
+    }
+
+
+    // Callable from any thread.
+    bool enabled() const {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+
+    // Sets the number of spectrum frames computed per second, which
+    // is clamped to [`min_frame_rate`, `max_frame_rate`]. Callable
+    // from any thread.
+    void set_frame_rate(double frame_rate) {
+        frame_rate = std::max(min_frame_rate, std::min(frame_rate, max_frame_rate));
+        _frame_rate.store(frame_rate, std::memory_order_relaxed);
+    }
+
+
+    double frame_rate() const {
+        return _frame_rate.load(std::memory_order_relaxed);
+    }
+
+
+    // Returns the number of tapped frames dropped because the worker
+    // thread fell behind. Callable from any thread.
+    uint64_t dropped_count() const {
+        return _ring.dropped_count();
+    }
+
+
+    // Render thread tap. For each block, call `begin_tap`, and if it
+    // returns `true`, call `tap_input` and `tap_output`, and then
+    // `end_tap`. The input can be tapped before
+    // processing and the output after, so that processing in place
+    // does not overwrite the input before it is tapped. These do not
+    // lock, allocate, or perform I/O, and copy each sample once.
+    // Tapped samples are read `stride` floats apart, so that they can
+    // be one channel of interleaved audio.
+
+    bool begin_tap(size_t count) {
+        return _enabled.load(std::memory_order_relaxed) && _ring.reserve(count);
+    }
+
+    void tap_input(const float *samples, size_t count, size_t stride = 1) {
+        _ring.write(0, samples, count, stride);
+    }
+
+    void tap_output(const float *samples, size_t count, size_t stride = 1) {
+        _ring.write(1, samples, count, stride);
+    }
+
+    void end_tap(size_t count) {
+        _ring.commit(count);
+    }
+
+
+    // Copies the latest spectra to `input` and `output`, which must
+    // each have room for `bin_count` values. Call from only one
+    // thread, not the render thread. Returns the frame number of the
+    // spectra, which is zero if none have been computed yet.
+    uint64_t read_spectra(float *input, float *output) {
+        _frames.update();
+        const SpectrumFrame &frame = _frames.front();
+        std::copy(frame.input.begin(), frame.input.end(), input);
+        std::copy(frame.output.begin(), frame.output.end(), output);
+        return frame.frame_num;
+    }
+
+
+private:
+
+
+    // Ring capacity in frames, which must be a power of two and hold
+    // more than one period of the minimum frame rate.
+    static const size_t _ring_capacity = 16384;
+
+    typedef std::complex<float> Complex;
+
+    TapRing _ring;
+    TripleBuffer<SpectrumFrame> _frames;
+
+    // Most recent `fft_size` samples of each channel, oldest first.
+    vector<float> _input_history;
+    vector<float> _output_history;
+
+    vector<float> _read_buffers[2];
+    vector<float> _window;
+    vector<Complex> _fft_data;
+    vector<Complex> _twiddles;
+    vector<size_t> _bit_reversals;
+
+    std::atomic<bool> _enabled;
+    std::atomic<double> _frame_rate;
+
+    std::thread _worker;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stopping;
+
+    uint64_t _frame_count;
+
+
+    static SpectrumFrame _create_frame() {
+        SpectrumFrame frame;
+        frame.input.assign(bin_count, -200);
+        frame.output.assign(bin_count, -200);
+        return frame;
+    }
+
+
+    // Returns a Hann window scaled so that a full scale sinusoid at a
+    // bin center frequency has a magnitude of one.
+    static vector<float> _create_window() {
+
+        vector<double> window(fft_size);
+        double sum = 0;
+        for (size_t i = 0; i != fft_size; ++i) {
+            window[i] = .5 - .5 * std::cos(2 * M_PI * i / fft_size);
+            sum += window[i];
+        }
+
+        vector<float> scaled_window(fft_size);
+        for (size_t i = 0; i != fft_size; ++i)
+            scaled_window[i] = static_cast<float>(2 * window[i] / sum);
+
+        return scaled_window;
+
+    }
+
+
+    void _run() {
+
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        while (!_stopping) {
+
+            const auto period = std::chrono::duration<double>(
+                1 / _frame_rate.load(std::memory_order_relaxed));
+            _condition.wait_for(lock, period, [this] { return _stopping; });
+
+            if (!_stopping && _drain() != 0) {
+                SpectrumFrame &frame = _frames.back();
+                _compute_spectrum(_input_history, frame.input);
+                _compute_spectrum(_output_history, frame.output);
+                frame.frame_num = ++_frame_count;
+                _frames.publish();
+            }
+
+        }
+
+    }
+
+
+    // Moves all frames from the ring into the channel histories,
+    // keeping only the most recent `fft_size` of each channel. Returns
+    // the number of frames moved.
+    size_t _drain() {
+
+        float *channels[2] = { _read_buffers[0].data(), _read_buffers[1].data() };
+        size_t total_count = 0;
+
+        while (size_t count = _ring.read(channels, fft_size)) {
+            _append(_input_history, channels[0], count);
+            _append(_output_history, channels[1], count);
+            total_count += count;
+        }
+
+        return total_count;
+
+    }
+
+
+    static void _append(vector<float> &history, const float *samples, size_t count) {
+        const size_t keep_count = fft_size - count;
+        std::memmove(
+            history.data(), history.data() + count, keep_count * sizeof(float));
+        std::memcpy(history.data() + keep_count, samples, count * sizeof(float));
+    }
+
+
+    void _compute_spectrum(const vector<float> &samples, vector<float> &spectrum) {
+
+        for (size_t i = 0; i != fft_size; ++i)
+            _fft_data[_bit_reversals[i]] = Complex(samples[i] * _window[i], 0);
+
+        _fft();
+
+        for (size_t i = 0; i != bin_count; ++i) {
+            const float power = std::norm(_fft_data[i]);
+            spectrum[i] = power > 1e-20f ? 10 * std::log10(power) : -200;
+        }
+
+    }
+
+
+    void _init_fft() {
+
+        for (size_t i = 0; i != fft_size / 2; ++i)
+            _twiddles[i] = std::polar(1.f, static_cast<float>(-2 * M_PI * i / fft_size));
+
+        size_t bit_count = 0;
+        while ((size_t(1) << bit_count) < fft_size)
+            ++bit_count;
+
+        for (size_t i = 0; i != fft_size; ++i) {
+            size_t reversed = 0;
+            for (size_t b = 0; b != bit_count; ++b)
+                if (i & (size_t(1) << b))
+                    reversed |= size_t(1) << (bit_count - 1 - b);
+            _bit_reversals[i] = reversed;
+        }
+
+    }
+
+
+    // Computes the FFT of `_fft_data` in place, assuming its input was
+    // stored in bit-reversed order. This is an iterative radix-2
+    // decimation-in-time FFT, which is plenty fast at display rates.
+    void _fft() {
+
+        Complex *x = _fft_data.data();
+
+        for (size_t size = 2; size <= fft_size; size *= 2) {
+
+            const size_t half_size = size / 2;
+            const size_t twiddle_step = fft_size / size;
+
+            for (size_t start = 0; start != fft_size; start += size) {
+                for (size_t k = 0; k != half_size; ++k) {
+                    const Complex t = _twiddles[k * twiddle_step] * x[start + k + half_size];
+                    const Complex u = x[start + k];
+                    x[start + k] = u + t;
+                    x[start + k + half_size] = u - t;
+                }
+            }
+
+        }
+
+    }
+
+
+};
+
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef TAP_RING
+#define TAP_RING
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+using std::size_t;
+using std::vector;
+
+
+// Wait-free, single-producer, single-consumer ring of multichannel
+// audio samples.
+//
+// A `SpectrumAnalyzer` uses one of these to get audio from the render
+// thread to its worker thread, and a `SongFinderDSPKernel` rendering
+// asynchronously uses two to get audio to and from its worker thread.
+// The producer reserves room for a block of frames, writes each
+// channel of the block with one copy, and then commits the block,
+// which makes it available to the consumer. The
+// channels of a block can thus be written at different times during a
+// render cycle. Neither the producer nor the consumer methods lock,
+// allocate, or perform I/O. If there is not enough room for a block,
+// the producer drops the whole block, so the channels stay aligned.
+
+
+class TapRing {
+
+
+public:
+
+
+    // `capacity` is the number of frames the ring holds, and must be
+    // a power of two.
+    TapRing(unsigned channel_count, size_t capacity) :
+        _channel_count(channel_count),
+        _capacity(capacity),
+        _index_mask(capacity - 1),
+        _samples(channel_count * capacity),
+        _write_index(0),
+        _read_index(0),
+        _dropped_count(0)
+    { }
+
+
+    TapRing(const TapRing &) = delete;
+    TapRing &operator=(const TapRing &) = delete;
+
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+
+    // Returns the number of frames dropped because the ring was full.
+    // Callable from any thread.
+    uint64_t dropped_count() const {
+        return _dropped_count.load(std::memory_order_relaxed);
+    }
+
+
+    // Reserves room for `count` frames. Call only from the producer
+    // thread. Returns `false` if there is not enough room, in which
+    // case the block is dropped and must not be written or committed.
+    bool reserve(size_t count) {
+
+        const size_t write_index = _write_index.load(std::memory_order_relaxed);
+        const size_t read_index = _read_index.load(std::memory_order_acquire);
+
+        if (_capacity - (write_index - read_index) < count) {
+            _dropped_count.store(
+                _dropped_count.load(std::memory_order_relaxed) + count,
+                std::memory_order_relaxed);
+            return false;
+        }
+
+        return true;
+
+    }
+
+
+    // Writes `count` samples of channel `channel` of a reserved block,
+    // read `stride` floats apart from `samples`. Call only from the
+    // producer thread.
+    void write(
+        unsigned channel, const float *samples, size_t count,
+        size_t stride = 1) {
+        const size_t start = _write_index.load(std::memory_order_relaxed);
+        if (stride == 1)
+            _copy_in(_channel_data(channel), start, samples, count);
+        else
+            _copy_in_strided(
+                _channel_data(channel), start, samples, count, stride);
+    }
+
+
+    // Makes a reserved block of `count` frames available to the
+    // consumer. Call only from the producer thread.
+    void commit(size_t count) {
+        const size_t write_index = _write_index.load(std::memory_order_relaxed);
+        _write_index.store(write_index + count, std::memory_order_release);
+    }
+
+
+    // Returns the number of frames available to the consumer. Call only
+    // from the consumer thread.
+    size_t available() const {
+        return _write_index.load(std::memory_order_acquire) -
+            _read_index.load(std::memory_order_relaxed);
+    }
+
+
+    // Removes up to `max_count` frames from the ring without reading
+    // them. Call only from the consumer thread. Returns the number of
+    // frames removed.
+    size_t discard(size_t max_count) {
+
+        const size_t read_index = _read_index.load(std::memory_order_relaxed);
+        const size_t write_index = _write_index.load(std::memory_order_acquire);
+
+        size_t count = write_index - read_index;
+        if (count > max_count)
+            count = max_count;
+
+        _read_index.store(read_index + count, std::memory_order_release);
+
+        return count;
+
+    }
+
+
+    // Reads up to `max_count` frames, writing channel `i` to
+    // `channels[i]`, and removes them from the ring. Call only from the
+    // consumer thread. Returns the number of frames read.
+    size_t read(float *const *channels, size_t max_count) {
+
+        const size_t read_index = _read_index.load(std::memory_order_relaxed);
+        const size_t write_index = _write_index.load(std::memory_order_acquire);
+
+        size_t count = write_index - read_index;
+        if (count > max_count)
+            count = max_count;
+
+        for (unsigned i = 0; i != _channel_count; ++i)
+            _copy_out(channels[i], _channel_data(i), read_index, count);
+
+        _read_index.store(read_index + count, std::memory_order_release);
+
+        return count;
+
+    }
+
+
+private:
+
+
+    unsigned _channel_count;
+    size_t _capacity;
+    size_t _index_mask;
+
+    // Channel `i` occupies `_samples[i * _capacity, (i + 1) * _capacity)`.
+    vector<float> _samples;
+
+    // Free-running frame indices. The ring holds the frames with
+    // indices in [_read_index, _write_index).
+    std::atomic<size_t> _write_index;
+    std::atomic<size_t> _read_index;
+
+    // Written only by the producer.
+    std::atomic<uint64_t> _dropped_count;
+
+
+    float *_channel_data(unsigned channel) {
+        return _samples.data() + channel * _capacity;
+    }
+
+
+    // Copies `count` samples to a channel starting at frame index
+    // `index`, wrapping around the end of the channel if needed.
+    void _copy_in(float *data, size_t index, const float *samples, size_t count) {
+        const size_t start = index & _index_mask;
+        const size_t first_count = std::min(count, _capacity - start);
+        std::memcpy(data + start, samples, first_count * sizeof(float));
+        std::memcpy(data, samples + first_count, (count - first_count) * sizeof(float));
+    }
+
+
+    void _copy_in_strided(
+        float *data, size_t index, const float *samples, size_t count,
+        size_t stride) {
+        for (size_t i = 0; i != count; ++i)
+            data[(index + i) & _index_mask] = samples[i * stride];
+    }
+
+
+    void _copy_out(float *samples, const float *data, size_t index, size_t count) {
+        const size_t start = index & _index_mask;
+        const size_t first_count = std::min(count, _capacity - start);
+        std::memcpy(samples, data + start, first_count * sizeof(float));
+        std::memcpy(samples + first_count, data, (count - first_count) * sizeof(float));
+    }
+
+
+};
+
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef TRIPLE_BUFFER
+#define TRIPLE_BUFFER
+
+
+#include <atomic>
+
+
+// Wait-free triple buffer, which passes successive values of type `T`
+// from one writer thread to one reader thread.
+//
+// The writer fills in the back value and publishes it, and the reader
+// takes the most recently published value as its front value. The
+// third value sits between them, so neither ever waits for the other
+// or sees a value while it is being written. The reader sees only the
+// latest published value, skipping any it was too slow to see. All
+// three values are constructed up front, so if `T` holds preallocated
+// storage, neither side allocates.
+
+
+template <class T>
+class TripleBuffer {
+
+
+public:
+
+
+    TripleBuffer(const T &initial_value) :
+        _values { initial_value, initial_value, initial_value },
+        _back(0),
+        _middle(1),
+        _front(2)
+    { }
+
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+
+    // Returns the value for the writer to fill in. Call only from the
+    // writer thread.
+    T &back() {
+        return _values[_back];
+    }
+
+
+    // Publishes the back value. Call only from the writer thread.
+    void publish() {
+        const unsigned middle =
+            _middle.exchange(_back | _new_flag, std::memory_order_acq_rel);
+        _back = middle & _index_mask;
+    }
+
+
+    // Takes the latest published value as the front value, if one has
+    // been published since the last call. Call only from the reader
+    // thread. Returns `true` if the front value changed.
+    bool update() {
+
+        if ((_middle.load(std::memory_order_relaxed) & _new_flag) == 0)
+            return false;
+
+        const unsigned middle =
+            _middle.exchange(_front, std::memory_order_acq_rel);
+        _front = middle & _index_mask;
+
+        return true;
+
+    }
+
+
+    // Returns the front value. Call only from the reader thread.
+    const T &front() const {
+        return _values[_front];
+    }
+
+
+private:
+
+
+    static const unsigned _index_mask = 3;
+    static const unsigned _new_flag = 4;
+
+    T _values[3];
+
+    // Index of the value owned by the writer.
+    unsigned _back;
+
+    // Index of the value in the middle, plus `_new_flag` if it has
+    // been published but not yet taken by the reader.
+    std::atomic<unsigned> _middle;
+
+    // Index of the value owned by the reader.
+    unsigned _front;
+
+
+};
+
+
+#endif
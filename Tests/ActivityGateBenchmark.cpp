@@ -0,0 +1,168 @@
+// Measures the processing time that the activity gate saves on input
+// like a field recording, which has energy above the cutoff only now
+// and then.
+//
+// The input is a minute of a -70 dBFS noise floor, almost all of it
+// below the cutoff, with songs of 3-6 kHz chirps occupying a given
+// fraction of the time. For each song fraction and cutoff, the
+// benchmark processes the input with the gate disabled and enabled,
+// and prints the best of several times for each, the fraction of the
+// time saved, and the fraction of the input for which the gated
+// processor idled.
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "SongFinderProcessor.hpp"
+
+
+using std::vector;
+
+
+static const double sample_rate = SongFinderProcessor::standard_sample_rate;
+static const size_t block_size = 256;
+static const size_t frame_count = static_cast<size_t>(60 * sample_rate);
+static const unsigned repetition_count = 3;
+
+// Level of the noise floor in dBFS.
+static const double noise_level = -70;
+
+// A song is `chirp_count` chirps of `chirp_duration` seconds, starting
+// `chirp_period` seconds apart.
+static const unsigned chirp_count = 7;
+static const double chirp_duration = .1;
+static const double chirp_period = .2;
+static const double song_duration = 1.5;
+
+
+static vector<float> create_input(double song_fraction) {
+
+    std::mt19937 random(38);
+    std::normal_distribution<float> noise(0, 1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    vector<float> input(frame_count);
+
+    // Lowpass filtered white noise, which has little energy above a
+    // cutoff of a couple of kHz, like wind and traffic.
+    const float noise_gain = 6 * std::pow(10.f, float(noise_level) / 20);
+    float lowpassed = 0;
+    for (float &x : input) {
+        lowpassed = .97f * lowpassed + .03f * noise(random);
+        x = noise_gain * lowpassed;
+    }
+
+    // Songs at random intervals whose mean makes them occupy about
+    // `song_fraction` of the time.
+    const size_t song_size = static_cast<size_t>(song_duration * sample_rate);
+    const size_t chirp_size = static_cast<size_t>(chirp_duration * sample_rate);
+    size_t position = 0;
+    while (position < frame_count) {
+
+        position += static_cast<size_t>(
+            song_size * (1 - song_fraction) / song_fraction *
+            (.5 + uniform(random)));
+
+        for (unsigned i = 0; i != chirp_count; ++i) {
+
+            const size_t start =
+                position + static_cast<size_t>(i * chirp_period * sample_rate);
+            const double frequency = 3000 + 3000 * uniform(random);
+
+            for (size_t k = 0; k != chirp_size && start + k < frame_count; ++k) {
+                const double t = k / sample_rate;
+                const double envelope = std::sin(M_PI * t / chirp_duration);
+                input[start + k] += static_cast<float>(
+                    .1 * envelope *
+                    std::sin(2 * M_PI * (frequency * t + 4000 * t * t)));
+            }
+
+        }
+
+        position += song_size;
+
+    }
+
+    return input;
+
+}
+
+
+// Returns the best time in seconds of processing `input`, and sets
+// `idle_fraction` to the fraction of it for which the processor idled.
+static double time_processing(
+    const vector<float> &input, unsigned cutoff, bool gated,
+    double &idle_fraction) {
+
+    ActivityGateSettings gate_settings;
+    gate_settings.enabled = gated;
+
+    vector<float> output(frame_count);
+    double best_time = INFINITY;
+
+    for (unsigned n = 0; n != repetition_count; ++n) {
+
+        SongFinderProcessor processor(
+            block_size, cutoff, 2, "SongFinder", .02, SongFinderKernels(), 0,
+            SongFinderQuality::Standard, gate_settings);
+
+        size_t idle_count = 0;
+
+        const auto start_time = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i + block_size <= frame_count; i += block_size) {
+            processor.process(&input[i], block_size, &output[i]);
+            if (processor.idle())
+                idle_count += block_size;
+        }
+
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start_time;
+
+        best_time = std::min(best_time, elapsed.count());
+        idle_fraction = double(idle_count) / frame_count;
+
+    }
+
+    return best_time;
+
+}
+
+
+int main() {
+
+    std::printf(
+        "Time in ms to process %.0f s of input with a %.0f dBFS noise floor "
+        "and songs\nfor a fraction of the time, in %zu-sample blocks:\n",
+        frame_count / sample_rate, noise_level, block_size);
+    std::printf("songs cutoff  ungated   gated  saved  idle\n");
+
+    for (double song_fraction : { .05, .15, .4 }) {
+
+        const vector<float> input = create_input(song_fraction);
+
+        for (unsigned cutoff : { 2000u, 0u }) {
+
+            double idle_fraction;
+            const double ungated_time =
+                time_processing(input, cutoff, false, idle_fraction);
+            const double gated_time =
+                time_processing(input, cutoff, true, idle_fraction);
+
+            std::printf(
+                "%4.0f%% %6u  %7.1f %7.1f  %4.0f%%  %3.0f%%\n",
+                100 * song_fraction, cutoff, ungated_time * 1e3,
+                gated_time * 1e3, 100 * (1 - gated_time / ungated_time),
+                100 * idle_fraction);
+
+        }
+
+    }
+
+    return 0;
+
+}
@@ -0,0 +1,284 @@
+// Simulates a host rendering a stereo `SongFinderDSPKernel` in
+// asynchronous mode, and checks the worker thread path, the fallback
+// when the worker falls behind, and the latency the kernel reports.
+//
+// The simulator calls the kernel's render function with 128-frame
+// buffers, sleeping between calls to give the worker thread time to
+// keep up, as the period of a real-time host would. It renders the
+// same input with a synchronous kernel and an asynchronous one, and
+// prints the mean render thread time per call of each, as a fraction
+// of the real-time period of a call, which is the headroom that
+// asynchronous rendering frees. It then checks that:
+//
+// * the asynchronous kernel reports the latency of the synchronous
+//   one plus the added latency,
+//
+// * its output is silent for the added latency and then exactly the
+//   output of the synchronous kernel delayed by the added latency,
+//   with no underruns,
+//
+// * when rendered with no pauses, so that its worker falls behind, it
+//   counts underruns and passes the input through in place of the
+//   frames that are not ready, with no non-finite output, and
+//
+// * once paced again, it stops underrunning.
+//
+// The kernel needs the AudioToolbox headers, so on platforms other
+// than macOS this test builds only if the Makefile is given
+// `KERNEL_FLAGS` that supply them.
+
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "SongFinderDSPKernel.hpp"
+#include "TestSupport.hpp"
+
+
+using std::vector;
+
+
+static const double sample_rate = 48000;
+static const AUAudioFrameCount frame_count = 128;
+static const std::chrono::microseconds call_pause(300);
+
+
+// A host's input and output buffers for a stereo kernel.
+class Host {
+
+public:
+
+    Host(SongFinderDSPKernel &kernel) : _kernel(kernel) {
+        for (unsigned c = 0; c != 2; ++c) {
+            inputs[c].resize(frame_count);
+            outputs[c].resize(frame_count);
+        }
+        _input_list = _create_buffer_list(inputs);
+        _output_list = _create_buffer_list(outputs);
+        kernel.setBuffers(_input_list, _output_list);
+    }
+
+    ~Host() {
+        std::free(_input_list);
+        std::free(_output_list);
+    }
+
+    // Renders one buffer, returning the render thread time in seconds.
+    double render() {
+        AudioTimeStamp timestamp = AudioTimeStamp();
+        timestamp.mSampleTime = AUEventSampleTime(_sample_time);
+        _sample_time += frame_count;
+        const auto start_time = std::chrono::steady_clock::now();
+        _kernel.processWithEvents(&timestamp, frame_count, nullptr, nullptr);
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start_time;
+        return elapsed.count();
+    }
+
+    vector<float> inputs[2];
+    vector<float> outputs[2];
+
+private:
+
+    static AudioBufferList *_create_buffer_list(vector<float> *channels) {
+        AudioBufferList *list = static_cast<AudioBufferList *>(std::calloc(
+            1, sizeof(AudioBufferList) + sizeof(AudioBuffer)));
+        list->mNumberBuffers = 2;
+        for (UInt32 i = 0; i != 2; ++i) {
+            list->mBuffers[i].mNumberChannels = 1;
+            list->mBuffers[i].mDataByteSize = frame_count * sizeof(float);
+            list->mBuffers[i].mData = channels[i].data();
+        }
+        return list;
+    }
+
+    SongFinderDSPKernel &_kernel;
+    AudioBufferList *_input_list;
+    AudioBufferList *_output_list;
+    uint64_t _sample_time = 0;
+
+};
+
+
+static void configure(SongFinderDSPKernel &kernel) {
+    kernel.setMaximumFramesToRender(frame_count);
+    kernel.setParameter(Cutoff, 2000);
+    kernel.setParameter(PitchShift, 4);
+}
+
+
+static void fill(Host &host, std::mt19937 &random) {
+    std::uniform_real_distribution<float> samples(-.3f, .3f);
+    for (vector<float> &input : host.inputs)
+        for (float &x : input)
+            x = samples(random);
+}
+
+
+// Checks the paced asynchronous path against the synchronous one.
+static void test_paced() {
+
+    const AUAudioFrameCount added_latency = 4096;
+    const unsigned call_count = 1500;
+
+    SongFinderDSPKernel sync_kernel, async_kernel;
+    configure(sync_kernel);
+    configure(async_kernel);
+    async_kernel.setAsyncRendering(true, added_latency);
+    sync_kernel.allocateRenderResources(2, 2, sample_rate);
+    async_kernel.allocateRenderResources(2, 2, sample_rate);
+
+    check(
+        async_kernel.latencyFrames() ==
+            sync_kernel.latencyFrames() + added_latency,
+        "asynchronous kernel reports latency %u rather than %u",
+        async_kernel.latencyFrames(),
+        sync_kernel.latencyFrames() + added_latency);
+
+    Host sync_host(sync_kernel), async_host(async_kernel);
+    std::mt19937 random(49);
+
+    vector<float> sync_outputs[2], async_outputs[2];
+    double sync_time = 0, async_time = 0;
+
+    for (unsigned n = 0; n != call_count; ++n) {
+
+        fill(sync_host, random);
+        async_host.inputs[0] = sync_host.inputs[0];
+        async_host.inputs[1] = sync_host.inputs[1];
+
+        sync_time += sync_host.render();
+        async_time += async_host.render();
+
+        for (unsigned c = 0; c != 2; ++c) {
+            sync_outputs[c].insert(
+                sync_outputs[c].end(), sync_host.outputs[c].begin(),
+                sync_host.outputs[c].end());
+            async_outputs[c].insert(
+                async_outputs[c].end(), async_host.outputs[c].begin(),
+                async_host.outputs[c].end());
+        }
+
+        std::this_thread::sleep_for(call_pause);
+
+    }
+
+    const double period = frame_count / sample_rate;
+    std::printf(
+        "Render thread time per %u-frame call: sync %.2f us (%.1f%% of "
+        "period), async %.2f us (%.1f%% of period)\n", frame_count,
+        sync_time / call_count * 1e6, 100 * sync_time / call_count / period,
+        async_time / call_count * 1e6, 100 * async_time / call_count / period);
+
+    const uint64_t underrun_count = async_kernel.asyncUnderrunFrameCount();
+
+    size_t silent_count = 0, delayed_count = 0;
+    for (unsigned c = 0; c != 2; ++c) {
+        for (size_t t = 0; t != added_latency; ++t)
+            silent_count += async_outputs[c][t] == 0;
+        for (size_t t = added_latency; t != async_outputs[c].size(); ++t)
+            delayed_count +=
+                async_outputs[c][t] == sync_outputs[c][t - added_latency];
+    }
+
+    check(
+        underrun_count == 0,
+        "paced asynchronous kernel underran %llu frames",
+        (unsigned long long) underrun_count);
+
+    check(
+        silent_count == 2 * added_latency,
+        "asynchronous output not silent for added latency");
+
+    check(
+        delayed_count == 2 * (async_outputs[0].size() - added_latency),
+        "asynchronous output is not delayed synchronous output at %zu "
+        "samples", 2 * (async_outputs[0].size() - added_latency) -
+        delayed_count);
+
+    sync_kernel.deallocateRenderResources();
+    async_kernel.deallocateRenderResources();
+
+}
+
+
+// Checks the fallback when the worker thread falls behind.
+static void test_underrun() {
+
+    SongFinderDSPKernel kernel;
+    configure(kernel);
+    kernel.setAsyncRendering(true, 1024);
+    kernel.allocateRenderResources(2, 2, sample_rate);
+
+    Host host(kernel);
+    std::mt19937 random(49);
+
+    // Render with no pauses, which the worker cannot keep up with.
+    size_t passed_count = 0, nonfinite_count = 0;
+    for (unsigned n = 0; n != 4000; ++n) {
+        fill(host, random);
+        host.render();
+        for (AUAudioFrameCount k = 0; k != frame_count; ++k) {
+            passed_count +=
+                host.outputs[0][k] == host.inputs[0][k] &&
+                host.outputs[1][k] == host.inputs[1][k];
+            nonfinite_count +=
+                !std::isfinite(host.outputs[0][k]) ||
+                !std::isfinite(host.outputs[1][k]);
+        }
+    }
+
+    const uint64_t underrun_count = kernel.asyncUnderrunFrameCount();
+
+    check(
+        underrun_count != 0,
+        "unpaced asynchronous kernel did not underrun");
+
+    check(
+        passed_count >= underrun_count,
+        "asynchronous kernel passed %zu input frames through in place of "
+        "%llu frames it underran", passed_count,
+        (unsigned long long) underrun_count);
+
+    check(
+        nonfinite_count == 0,
+        "asynchronous kernel output %zu non-finite frames while underrunning",
+        nonfinite_count);
+
+    // Render with pauses again, giving the worker time to catch up,
+    // after which there must be no more underruns.
+    for (unsigned n = 0; n != 1000; ++n) {
+        fill(host, random);
+        host.render();
+        std::this_thread::sleep_for(call_pause);
+    }
+
+    const uint64_t caught_up_count = kernel.asyncUnderrunFrameCount();
+
+    for (unsigned n = 0; n != 500; ++n) {
+        fill(host, random);
+        host.render();
+        std::this_thread::sleep_for(call_pause);
+    }
+
+    check(
+        kernel.asyncUnderrunFrameCount() == caught_up_count,
+        "paced asynchronous kernel kept underrunning after falling behind");
+
+    kernel.deallocateRenderResources();
+
+}
+
+
+int main() {
+
+    test_paced();
+    test_underrun();
+
+    return test_result("AsyncRenderTest");
+
+}
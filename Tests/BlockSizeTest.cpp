@@ -0,0 +1,128 @@
+// Checks that a `SongFinderProcessor`'s output does not depend on the
+// sizes of the blocks its input arrives in.
+//
+// For each of a range of configurations, the same random input is
+// given to several processors, one in blocks of the max input size and
+// the others in random sequences of block sizes from one to the max
+// input size. Since a processor primed with the minimum number of
+// zeros always has enough output for any block size (see the comment
+// near the top of SongFinderProcessor.hpp), all of the processors must
+// produce exactly the same output, without zero-filling any of it and
+// without any of their buffers overflowing or underflowing.
+
+
+#include <random>
+#include <vector>
+#include "SongFinderProcessor.hpp"
+#include "TestSupport.hpp"
+
+
+using std::vector;
+
+
+static const size_t frame_count = 24000;
+static const unsigned partition_count = 4;
+
+
+// Processes `input`, which holds `frame_count` interleaved frames of
+// `channel_count` channels, in blocks of random sizes from one to
+// `max_input_size` drawn with `random`, or all of `max_input_size` if
+// `random` is null, and returns the interleaved output.
+static vector<float> process(
+    SongFinderProcessor &processor, const vector<float> &input,
+    unsigned channel_count, size_t max_input_size, std::mt19937 *random) {
+
+    std::uniform_int_distribution<size_t> block_sizes(1, max_input_size);
+
+    vector<float> output(input.size());
+
+    size_t i = 0;
+    while (i != frame_count) {
+
+        const size_t n = std::min(
+            random != nullptr ? block_sizes(*random) : max_input_size,
+            frame_count - i);
+
+        const float *inputs[2] = { };
+        float *outputs[2] = { };
+        for (unsigned c = 0; c != channel_count; ++c) {
+            inputs[c] = &input[i * channel_count + c];
+            outputs[c] = &output[i * channel_count + c];
+        }
+
+        processor.process(inputs, n, outputs, channel_count, channel_count);
+
+        i += n;
+
+    }
+
+    return output;
+
+}
+
+
+static bool no_buffer_errors(const DiagnosticsRing &diagnostics) {
+    return diagnostics.count(DiagnosticEventType::ZeroFill) == 0 &&
+        diagnostics.count(DiagnosticEventType::BufferOverflow) == 0 &&
+        diagnostics.count(DiagnosticEventType::BufferUnderflow) == 0;
+}
+
+
+int main() {
+
+    std::mt19937 random(29);
+    std::uniform_real_distribution<float> samples(-1, 1);
+
+    for (unsigned channel_count : { 1u, 2u })
+    for (size_t max_input_size : { 1u, 17u, 128u, 1000u })
+    for (size_t block_size : { 0u, 64u })
+    for (unsigned cutoff : { 0u, 2000u })
+    for (unsigned pitch_shift_factor : { 2u, 3u, 4u }) {
+
+        vector<float> input(frame_count * channel_count);
+        for (float &x : input)
+            x = samples(random);
+
+        auto make_processor = [&]() {
+            return SongFinderProcessor(
+                max_input_size, cutoff, pitch_shift_factor, "SongFinder",
+                .02, SongFinderKernels(), block_size,
+                SongFinderQuality::Standard, ActivityGateSettings(),
+                SongFinderProcessor::standard_sample_rate, channel_count);
+        };
+
+        DiagnosticsRing reference_diagnostics;
+        SongFinderProcessor reference = make_processor();
+        reference.set_diagnostics(&reference_diagnostics, 0);
+        const vector<float> expected = process(
+            reference, input, channel_count, max_input_size, nullptr);
+
+        check(
+            no_buffer_errors(reference_diagnostics),
+            "buffer errors with fixed block size: channels %u, "
+            "max input size %zu, block size %zu, cutoff %u, shift %u",
+            channel_count, max_input_size, block_size, cutoff,
+            pitch_shift_factor);
+
+        for (unsigned i = 0; i != partition_count; ++i) {
+
+            DiagnosticsRing diagnostics;
+            SongFinderProcessor processor = make_processor();
+            processor.set_diagnostics(&diagnostics, 0);
+            const vector<float> output = process(
+                processor, input, channel_count, max_input_size, &random);
+
+            check(
+                output == expected && no_buffer_errors(diagnostics),
+                "output depends on block sizes: channels %u, "
+                "max input size %zu, block size %zu, cutoff %u, shift %u",
+                channel_count, max_input_size, block_size, cutoff,
+                pitch_shift_factor);
+
+        }
+
+    }
+
+    return test_result("BlockSizeTest");
+
+}
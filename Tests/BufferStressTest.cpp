@@ -0,0 +1,86 @@
+// Checks that the exactly sized buffers of a `SongFinderProcessor`
+// never overflow or underflow.
+//
+// Each processor is given up to a thousand blocks of random sizes
+// from one to its max input size, with a block of the max input size
+// every few blocks, since those push the buffers to their largest
+// occupancies.
+// See the comment near the top of SongFinderProcessor.hpp for how the
+// buffer sizes are derived.
+
+
+#include <random>
+#include <vector>
+#include "SongFinderProcessor.hpp"
+#include "TestSupport.hpp"
+
+
+using std::vector;
+
+
+// Numbers of blocks and of input frames after which each processor
+// stops.
+static const size_t max_block_count = 1000;
+static const size_t max_frame_count = 100000;
+
+
+int main() {
+
+    std::mt19937 random(31);
+    std::uniform_real_distribution<float> samples(-1, 1);
+
+    for (unsigned channel_count : { 1u, 2u })
+    for (size_t max_input_size : { 1u, 17u, 128u, 512u, 4096u })
+    for (size_t block_size : { 0u, 100u })
+    for (unsigned cutoff : { 0u, 2000u, 4000u })
+    for (unsigned pitch_shift_factor : { 2u, 3u, 4u })
+    for (double window_duration : { .005, .02, .05 }) {
+
+        DiagnosticsRing diagnostics;
+
+        SongFinderProcessor processor(
+            max_input_size, cutoff, pitch_shift_factor, "SongFinder",
+            window_duration, SongFinderKernels(), block_size,
+            SongFinderQuality::Standard, ActivityGateSettings(),
+            SongFinderProcessor::standard_sample_rate, channel_count);
+        processor.set_diagnostics(&diagnostics, 0);
+
+        vector<float> input(max_input_size * channel_count);
+        vector<float> output(input.size());
+        for (float &x : input)
+            x = samples(random);
+
+        const float *inputs[2] = { input.data(), input.data() + 1 };
+        float *outputs[2] = { output.data(), output.data() + 1 };
+
+        std::uniform_int_distribution<size_t> block_sizes(1, max_input_size);
+
+        const size_t block_count =
+            std::min(max_block_count, max_frame_count / max_input_size);
+
+        for (size_t i = 0; i != block_count; ++i) {
+            const size_t n = i % 7 == 0 ? max_input_size : block_sizes(random);
+            processor.process(
+                inputs, n, outputs, channel_count, channel_count);
+        }
+
+        const uint64_t overflow_count =
+            diagnostics.count(DiagnosticEventType::BufferOverflow);
+        const uint64_t underflow_count =
+            diagnostics.count(DiagnosticEventType::BufferUnderflow);
+
+        check(
+            overflow_count == 0 && underflow_count == 0,
+            "%llu buffer overflows and %llu underflows: channels %u, "
+            "max input size %zu, block size %zu, cutoff %u, shift %u, "
+            "window %g s",
+            static_cast<unsigned long long>(overflow_count),
+            static_cast<unsigned long long>(underflow_count),
+            channel_count, max_input_size, block_size, cutoff,
+            pitch_shift_factor, window_duration);
+
+    }
+
+    return test_result("BufferStressTest");
+
+}
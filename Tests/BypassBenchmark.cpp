@@ -0,0 +1,161 @@
+// Measures the cost of a `SongFinderDSPKernel` render callback while
+// the kernel is bypassed, compared with while it is processing.
+//
+// A bypassed kernel suspends its processors and just copies its input
+// to its output, or does nothing when rendering in place, and meters
+// the output levels as always. So a bypassed callback should cost
+// about as much as copying and metering the block, which is nearly
+// nothing next to processing it. For each callback size, with separate
+// and with in-place buffers, the benchmark prints the mean time per
+// callback of a processing kernel, of the same kernel once its fade
+// into bypass is complete, and of copying the block's channels with
+// `std::copy`. The input is a sinusoid, restored before each callback
+// since rendering in place overwrites it.
+//
+// The kernel needs the AudioToolbox headers, so on platforms other
+// than macOS this benchmark builds only if the Makefile is given
+// `KERNEL_FLAGS` that supply them.
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "SongFinderDSPKernel.hpp"
+
+
+using std::vector;
+
+
+static const double sample_rate = 48000;
+static const int callback_count = 4000;
+
+// Callbacks rendered after bypass is set before timing starts, which
+// covers the fade into bypass.
+static const int fade_callback_count = 100;
+
+
+static AudioBufferList *create_buffer_list(
+    vector<float> *channels, AUAudioFrameCount frame_count) {
+
+    AudioBufferList *list = static_cast<AudioBufferList *>(std::calloc(
+        1, sizeof(AudioBufferList) + sizeof(AudioBuffer)));
+
+    list->mNumberBuffers = 2;
+    for (UInt32 i = 0; i != 2; ++i) {
+        list->mBuffers[i].mNumberChannels = 1;
+        list->mBuffers[i].mDataByteSize = frame_count * sizeof(float);
+        list->mBuffers[i].mData = channels[i].data();
+    }
+
+    return list;
+
+}
+
+
+// Renders `count` callbacks of `signal.size()` frames starting at
+// `sample_time`, copying `signal` to each channel of `inputs` before
+// each one, and returns their mean time in seconds.
+static double time_callbacks(
+    SongFinderDSPKernel &kernel, const vector<float> &signal,
+    vector<float> *inputs, int count, AUEventSampleTime &sample_time) {
+
+    const AUAudioFrameCount frame_count = AUAudioFrameCount(signal.size());
+    double time = 0;
+
+    for (int i = 0; i != count; ++i) {
+
+        for (unsigned c = 0; c != 2; ++c)
+            std::copy(signal.begin(), signal.end(), inputs[c].begin());
+
+        AudioTimeStamp timestamp = AudioTimeStamp();
+        timestamp.mSampleTime = sample_time;
+        sample_time += frame_count;
+
+        const auto start_time = std::chrono::steady_clock::now();
+
+        kernel.processWithEvents(&timestamp, frame_count, nullptr, nullptr);
+
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start_time;
+        time += elapsed.count();
+
+    }
+
+    return time / count;
+
+}
+
+
+static void run(AUAudioFrameCount frame_count, bool in_place) {
+
+    SongFinderDSPKernel kernel;
+    kernel.setMaximumFramesToRender(frame_count);
+    kernel.setParameter(Cutoff, 2000);
+    kernel.allocateRenderResources(2, 2, sample_rate);
+
+    vector<float> signal(frame_count);
+    for (AUAudioFrameCount i = 0; i != frame_count; ++i)
+        signal[i] = static_cast<float>(
+            .3 * std::sin(2 * M_PI * 3000 * i / sample_rate));
+
+    vector<float> inputs[2], outputs[2];
+    for (unsigned c = 0; c != 2; ++c) {
+        inputs[c].resize(frame_count);
+        outputs[c].resize(frame_count);
+    }
+    AudioBufferList *input_list = create_buffer_list(inputs, frame_count);
+    AudioBufferList *output_list =
+        create_buffer_list(in_place ? inputs : outputs, frame_count);
+    kernel.setBuffers(input_list, output_list);
+
+    AUEventSampleTime sample_time = 0;
+
+    const double processing_time = time_callbacks(
+        kernel, signal, inputs, callback_count, sample_time);
+
+    kernel.setBypassed(true);
+    time_callbacks(kernel, signal, inputs, fade_callback_count, sample_time);
+    const double bypassed_time = time_callbacks(
+        kernel, signal, inputs, callback_count, sample_time);
+
+    double copy_time = 0;
+    for (int i = 0; i != callback_count; ++i) {
+        const auto start_time = std::chrono::steady_clock::now();
+        for (unsigned c = 0; c != 2; ++c)
+            std::copy(inputs[c].begin(), inputs[c].end(), outputs[c].begin());
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start_time;
+        copy_time += elapsed.count();
+    }
+    copy_time /= callback_count;
+
+    std::printf(
+        "%5u %8s  %10.3f %8.3f %6.3f\n", frame_count,
+        in_place ? "in place" : "separate", processing_time * 1e6,
+        bypassed_time * 1e6, copy_time * 1e6);
+
+    kernel.deallocateRenderResources();
+    std::free(input_list);
+    std::free(output_list);
+
+}
+
+
+int main() {
+
+    std::printf(
+        "Mean time in us per stereo callback of a processing kernel, of a "
+        "bypassed one,\nand of copying the callback's input to its "
+        "output:\n");
+    std::printf("frames  buffers  processing bypassed   copy\n");
+
+    for (AUAudioFrameCount frame_count : { 128u, 512u })
+    for (bool in_place : { false, true })
+        run(frame_count, in_place);
+
+    return 0;
+
+}
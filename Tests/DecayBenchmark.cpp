@@ -0,0 +1,127 @@
+// Measures the cost of processing input that decays exponentially into
+// silence, with and without a `DenormalGuard`.
+//
+// The input is white noise whose level falls steadily from 0 dBFS to
+// far below the smallest normal float over the first three quarters of
+// the run, and is zero for the rest. Normally the processor skips its
+// stages once the input has stayed below
+// `SongFinderProcessor::silence_threshold`, about -200 dBFS, for its
+// silence horizon, long before anything in it is subnormal. To measure
+// what the guard saves, the first two runs turn silence skipping off,
+// so the stages process the input all the way down through the
+// subnormal range, first without the guard and then with it. The third
+// run skips silence as the kernel does, for comparison. The benchmark
+// prints the mean time per block of each segment of each run, and the
+// fraction of blocks that the processor skipped as silent.
+
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "DenormalGuard.hpp"
+#include "SongFinderProcessor.hpp"
+
+
+using std::vector;
+
+
+static const double sample_rate = SongFinderProcessor::standard_sample_rate;
+static const size_t block_size = 128;
+static const size_t frame_count = static_cast<size_t>(6 * sample_rate);
+static const size_t segment_size = static_cast<size_t>(.5 * sample_rate);
+
+// Decay in dB over the first three quarters of the run, which takes the
+// level well below the smallest subnormal float, about -899 dBFS.
+static const double decay = 920;
+
+
+static vector<float> create_input() {
+
+    std::mt19937 random(47);
+    std::uniform_real_distribution<float> samples(-1, 1);
+
+    const size_t decay_size = frame_count * 3 / 4;
+    const double factor = std::pow(10., -decay / 20 / decay_size);
+
+    vector<float> input(frame_count);
+    double level = 1;
+    for (size_t i = 0; i != decay_size; ++i) {
+        input[i] = static_cast<float>(level * samples(random));
+        level *= factor;
+    }
+
+    return input;
+
+}
+
+
+static void run(
+    const vector<float> &input, const char *name, bool guarded,
+    bool skipping) {
+
+    SongFinderProcessor processor(block_size, 2000, 2, "SongFinder", .02);
+    processor.set_silence_skipping(skipping);
+
+    vector<float> output(block_size);
+    size_t skipped_count = 0;
+
+    std::printf("%-15s", name);
+
+    for (size_t start = 0; start < frame_count; start += segment_size) {
+
+        const size_t end = std::min(start + segment_size, frame_count);
+        size_t count = 0;
+
+        const auto start_time = std::chrono::steady_clock::now();
+
+        for (size_t i = start; i + block_size <= end; i += block_size) {
+
+            if (guarded) {
+                DenormalGuard guard;
+                processor.process(&input[i], block_size, output.data());
+            } else {
+                processor.process(&input[i], block_size, output.data());
+            }
+
+            if (processor.silent())
+                ++skipped_count;
+
+            ++count;
+
+        }
+
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start_time;
+
+        std::printf(" %7.2f", elapsed.count() / count * 1e6);
+
+    }
+
+    std::printf(
+        "  us/block, %.0f%% of blocks skipped\n",
+        100. * skipped_count / (frame_count / block_size));
+
+}
+
+
+int main() {
+
+    const vector<float> input = create_input();
+
+    std::printf(
+        "Input level falls from 0 to -%.0f dBFS over %.1f s and is zero "
+        "for %.1f s.\n", decay, frame_count * .75 / sample_rate,
+        frame_count * .25 / sample_rate);
+    std::printf(
+        "Mean time per %zu-sample block for each %.1f s segment:\n",
+        block_size, segment_size / sample_rate);
+
+    run(input, "no guard", false, false);
+    run(input, "guard", true, false);
+    run(input, "guard, skipping", true, true);
+
+    return 0;
+
+}
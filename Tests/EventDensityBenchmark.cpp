@@ -0,0 +1,136 @@
+// Measures the cost of a `SongFinderDSPKernel` render callback as a
+// function of the number of gain and balance events in it.
+//
+// Parameter events do not split rendering, so however many events a
+// callback has, the kernel renders it with one call to `process` and
+// applies the events at their offsets in its gain loop. The cost per
+// callback should therefore be nearly flat in the number of events. The
+// benchmark prints, for each event density, the number of `process`
+// calls per callback and the mean time per callback.
+//
+// The kernel needs the AudioToolbox headers, so on platforms other
+// than macOS this benchmark builds only if the Makefile is given
+// `KERNEL_FLAGS` that supply them.
+
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "SongFinderDSPKernel.hpp"
+
+
+using std::vector;
+
+
+static const AUAudioFrameCount frame_count = 512;
+static const int callback_count = 4000;
+
+
+// Counts the calls to `process` of a kernel.
+class CountingKernel : public SongFinderDSPKernel {
+
+public:
+
+    void process(
+        AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) override {
+        ++process_count;
+        SongFinderDSPKernel::process(frameCount, bufferOffset);
+    }
+
+    long process_count = 0;
+
+};
+
+
+static AudioBufferList *create_buffer_list(vector<float> *channels) {
+
+    AudioBufferList *list = static_cast<AudioBufferList *>(std::calloc(
+        1, sizeof(AudioBufferList) + sizeof(AudioBuffer)));
+
+    list->mNumberBuffers = 2;
+    for (UInt32 i = 0; i != 2; ++i) {
+        list->mBuffers[i].mNumberChannels = 1;
+        list->mBuffers[i].mDataByteSize = frame_count * sizeof(float);
+        list->mBuffers[i].mData = channels[i].data();
+    }
+
+    return list;
+
+}
+
+
+static void run(int event_count) {
+
+    CountingKernel kernel;
+    kernel.setMaximumFramesToRender(frame_count);
+    kernel.allocateRenderResources(2, 2, 48000);
+
+    vector<float> inputs[2] = {
+        vector<float>(frame_count, .1f), vector<float>(frame_count, .1f) };
+    vector<float> outputs[2] = {
+        vector<float>(frame_count), vector<float>(frame_count) };
+    AudioBufferList *input_list = create_buffer_list(inputs);
+    AudioBufferList *output_list = create_buffer_list(outputs);
+    kernel.setBuffers(input_list, output_list);
+
+    vector<AURenderEvent> events(event_count + 1);
+
+    double time = 0;
+
+    for (int i = 0; i != callback_count; ++i) {
+
+        const AUEventSampleTime start = AUEventSampleTime(i) * frame_count;
+
+        // Spread the events evenly over the callback, alternating
+        // between gain and balance.
+        for (int j = 0; j != event_count; ++j) {
+            AUParameterEvent &event = events[j].parameter;
+            event = AUParameterEvent();
+            event.eventSampleTime = start + j * frame_count / event_count;
+            event.eventType = AURenderEventParameter;
+            event.parameterAddress = j % 2 == 0 ? Gain : Balance;
+            event.value = -static_cast<AUValue>(j % 10);
+            event.next = j + 1 != event_count ? &events[j + 1] : nullptr;
+        }
+
+        AudioTimeStamp timestamp = AudioTimeStamp();
+        timestamp.mSampleTime = start;
+
+        const auto start_time = std::chrono::steady_clock::now();
+
+        kernel.processWithEvents(
+            &timestamp, frame_count,
+            event_count != 0 ? &events[0] : nullptr, nullptr);
+
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start_time;
+        time += elapsed.count();
+
+    }
+
+    std::printf(
+        "%4d events/callback: %.1f process calls/callback, "
+        "%6.2f us/callback\n",
+        event_count, double(kernel.process_count) / callback_count,
+        time / callback_count * 1e6);
+
+    kernel.deallocateRenderResources();
+    std::free(input_list);
+    std::free(output_list);
+
+}
+
+
+int main() {
+
+    std::printf(
+        "Stereo kernel, %u-frame callbacks, events spread evenly over "
+        "each callback:\n", frame_count);
+
+    for (int event_count : { 0, 1, 8, 64, 256 })
+        run(event_count);
+
+    return 0;
+
+}
@@ -0,0 +1,130 @@
+// Measures the cost of processing a stereo stream with one two-channel
+// `SongFinderProcessor` rather than two one-channel processors.
+//
+// A two-channel processor loads each window and filter coefficient
+// once per frame for both channels, so it should cost noticeably less
+// than two one-channel processors. For each of several configurations
+// and stage implementations, the benchmark prints the mean time per
+// stereo block of the pair of mono processors and of the stereo
+// processor, and the ratio of the two.
+
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "SongFinderProcessor.hpp"
+
+
+using std::vector;
+
+
+static const double sample_rate = SongFinderProcessor::standard_sample_rate;
+static const size_t block_size = 128;
+static const size_t block_count = static_cast<size_t>(4 * sample_rate) / block_size;
+
+
+static const char *fir_name(FirKernel kernel) {
+    return kernel == FirKernel::Direct ? "direct" : "blocked";
+}
+
+
+static const char *interpolator_name(InterpolatorKernel kernel) {
+    return kernel == InterpolatorKernel::Direct ? "direct" : "polyphase";
+}
+
+
+// Returns the mean time in microseconds of calling `process` with each
+// block index.
+template <class Process>
+static double time_blocks(Process process) {
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i != block_count; ++i)
+        process(i);
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start_time;
+
+    return elapsed.count() / block_count * 1e6;
+
+}
+
+
+static void run(
+    unsigned cutoff, unsigned pitch_shift_factor, SongFinderQuality quality,
+    SongFinderKernels kernels, const vector<float> (&inputs)[2]) {
+
+    auto make_processor = [&](unsigned channel_count) {
+        return SongFinderProcessor(
+            block_size, cutoff, pitch_shift_factor, "SongFinder", .02,
+            kernels, 0, quality, ActivityGateSettings(), sample_rate,
+            channel_count);
+    };
+
+    SongFinderProcessor mono[2] = { make_processor(1), make_processor(1) };
+    SongFinderProcessor stereo = make_processor(2);
+
+    vector<float> outputs[2] = {
+        vector<float>(block_size), vector<float>(block_size) };
+
+    const double mono_time = time_blocks([&](size_t i) {
+        for (unsigned c = 0; c != 2; ++c)
+            mono[c].process(
+                &inputs[c][i * block_size], block_size, outputs[c].data());
+    });
+
+    const double stereo_time = time_blocks([&](size_t i) {
+        const float *block_inputs[2] = {
+            &inputs[0][i * block_size], &inputs[1][i * block_size] };
+        float *block_outputs[2] = { outputs[0].data(), outputs[1].data() };
+        stereo.process(block_inputs, block_size, block_outputs);
+    });
+
+    std::printf(
+        "%5u %5u %7d %9s %12s  %7.2f %7.2f  %5.2f\n", cutoff,
+        pitch_shift_factor, int(quality), fir_name(kernels.fir),
+        interpolator_name(kernels.interpolator), mono_time, stereo_time,
+        stereo_time / mono_time);
+
+}
+
+
+int main() {
+
+    std::mt19937 random(50);
+    std::uniform_real_distribution<float> samples(-1, 1);
+
+    vector<float> inputs[2] = {
+        vector<float>(block_count * block_size),
+        vector<float>(block_count * block_size) };
+    for (vector<float> &input : inputs)
+        for (float &x : input)
+            x = samples(random);
+
+    std::printf(
+        "Mean time in us per %zu-frame stereo block of two mono processors "
+        "and of one stereo processor:\n", block_size);
+    std::printf(
+        "cutoff shift quality       FIR interpolator     mono  stereo  ratio\n");
+
+    for (unsigned cutoff : { 0u, 2000u })
+    for (unsigned pitch_shift_factor : { 2u, 4u })
+    for (SongFinderQuality quality :
+            { SongFinderQuality::Standard, SongFinderQuality::Economy })
+    for (FirKernel fir : { FirKernel::Direct, FirKernel::Blocked })
+    for (InterpolatorKernel interpolator :
+            { InterpolatorKernel::Direct, InterpolatorKernel::Polyphase }) {
+
+        // The FIR kernel does not matter without a highpass filter.
+        if (cutoff == 0 && fir != FirKernel::Direct)
+            continue;
+
+        run(cutoff, pitch_shift_factor, quality, { fir, interpolator }, inputs);
+
+    }
+
+    return 0;
+
+}
@@ -0,0 +1,116 @@
+// Checks that a two-channel `SongFinderProcessor` produces exactly the
+// samples of two one-channel processors with the same configuration.
+//
+// For each of a range of configurations and stage implementations,
+// a stereo processor and two mono processors process the same random
+// input, in the same random sequence of block sizes, and the output of
+// each channel of the stereo processor must equal that of the
+// corresponding mono processor bit for bit. The stereo processor reads
+// and writes its channels either interleaved or as separate arrays.
+// The activity gates are disabled and the input is never silent, since
+// the channels of a stereo processor share the decisions of whether to
+// idle and whether to skip silence.
+
+
+#include <random>
+#include <vector>
+#include "SongFinderProcessor.hpp"
+#include "TestSupport.hpp"
+
+
+using std::vector;
+
+
+static const size_t frame_count = 12000;
+static const size_t max_input_size = 300;
+
+
+int main() {
+
+    std::mt19937 random(50);
+    std::uniform_real_distribution<float> samples(-1, 1);
+    std::uniform_int_distribution<size_t> block_sizes(1, max_input_size);
+
+    for (unsigned cutoff : { 0u, 2000u })
+    for (unsigned pitch_shift_factor : { 2u, 3u, 4u })
+    for (size_t block_size : { 0u, 64u })
+    for (FirKernel fir : { FirKernel::Direct, FirKernel::Blocked })
+    for (InterpolatorKernel interpolator :
+            { InterpolatorKernel::Direct, InterpolatorKernel::Polyphase })
+    for (SongFinderQuality quality :
+            { SongFinderQuality::Standard, SongFinderQuality::Economy })
+    for (bool interleaved : { false, true }) {
+
+        const SongFinderKernels kernels = { fir, interpolator };
+
+        auto make_processor = [&](unsigned channel_count) {
+            return SongFinderProcessor(
+                max_input_size, cutoff, pitch_shift_factor, "SongFinder",
+                .02, kernels, block_size, quality, ActivityGateSettings(),
+                SongFinderProcessor::standard_sample_rate, channel_count);
+        };
+
+        SongFinderProcessor stereo = make_processor(2);
+        SongFinderProcessor mono[2] = { make_processor(1), make_processor(1) };
+
+        // Interleaved stereo input and output, and separate channels.
+        vector<float> input(2 * frame_count);
+        for (float &x : input)
+            x = samples(random);
+        vector<float> stereo_output(2 * frame_count);
+        vector<float> channel_inputs[2] = {
+            vector<float>(frame_count), vector<float>(frame_count) };
+        vector<float> channel_outputs[2] = {
+            vector<float>(frame_count), vector<float>(frame_count) };
+        vector<float> mono_outputs[2] = {
+            vector<float>(frame_count), vector<float>(frame_count) };
+        for (size_t i = 0; i != frame_count; ++i)
+            for (unsigned c = 0; c != 2; ++c)
+                channel_inputs[c][i] = input[2 * i + c];
+
+        for (size_t i = 0; i != frame_count; ) {
+
+            const size_t n = std::min(block_sizes(random), frame_count - i);
+
+            if (interleaved) {
+                const float *inputs[2] = { &input[2 * i], &input[2 * i + 1] };
+                float *outputs[2] = {
+                    &stereo_output[2 * i], &stereo_output[2 * i + 1] };
+                stereo.process(inputs, n, outputs, 2, 2);
+            } else {
+                const float *inputs[2] = {
+                    &channel_inputs[0][i], &channel_inputs[1][i] };
+                float *outputs[2] = {
+                    &channel_outputs[0][i], &channel_outputs[1][i] };
+                stereo.process(inputs, n, outputs);
+            }
+
+            for (unsigned c = 0; c != 2; ++c)
+                mono[c].process(&channel_inputs[c][i], n, &mono_outputs[c][i]);
+
+            i += n;
+
+        }
+
+        bool same = true;
+        for (size_t i = 0; i != frame_count; ++i)
+            for (unsigned c = 0; c != 2; ++c) {
+                const float x = interleaved ?
+                    stereo_output[2 * i + c] : channel_outputs[c][i];
+                if (x != mono_outputs[c][i])
+                    same = false;
+            }
+
+        check(
+            same,
+            "stereo processor output differs from mono processors: "
+            "cutoff %u, shift %u, block size %zu, FIR kernel %d, "
+            "interpolator kernel %d, quality %d, interleaved %d",
+            cutoff, pitch_shift_factor, block_size, int(fir),
+            int(interpolator), int(quality), interleaved);
+
+    }
+
+    return test_result("FusedStereoTest");
+
+}
@@ -0,0 +1,130 @@
+// Checks that `SongFinderProcessor::latency` is the delay of an impulse
+// at the start of an overlap-add window, and that an impulse `v`
+// samples into a window is delayed by a further
+// `(pitch_shift_factor - 1) * v` samples.
+//
+// A processor primes its input with W - 1 zeros, where W is the window
+// size in samples, so its windows start at input samples 1, W + 1,
+// 2W + 1, and so on. The delay of an impulse is measured as the
+// position of the largest output sample, which for a window-aligned
+// impulse is the center of the symmetric impulse responses of the
+// filters.
+
+
+#include <cmath>
+#include <vector>
+#include "SongFinderProcessor.hpp"
+#include "TestSupport.hpp"
+
+
+using std::vector;
+
+
+// Returns the delay of an impulse at input sample `impulse_index`.
+static size_t measure_delay(
+    SongFinderProcessor &processor, size_t impulse_index, size_t frame_count,
+    size_t max_input_size) {
+
+    const unsigned channel_count = processor.channel_count();
+
+    vector<float> input(frame_count * channel_count);
+    vector<float> output(input.size());
+    for (unsigned c = 0; c != channel_count; ++c)
+        input[impulse_index * channel_count + c] = 1;
+
+    for (size_t i = 0; i < frame_count; i += max_input_size) {
+
+        const size_t n = std::min(max_input_size, frame_count - i);
+
+        const float *inputs[2] = { };
+        float *outputs[2] = { };
+        for (unsigned c = 0; c != channel_count; ++c) {
+            inputs[c] = &input[i * channel_count + c];
+            outputs[c] = &output[i * channel_count + c];
+        }
+
+        processor.process(inputs, n, outputs, channel_count, channel_count);
+
+    }
+
+    // Find the largest sample of each channel, which must be at the
+    // same position in both.
+    size_t peak_index = 0;
+    for (unsigned c = 0; c != channel_count; ++c) {
+
+        size_t channel_peak_index = 0;
+        for (size_t i = 0; i != frame_count; ++i)
+            if (std::fabs(output[i * channel_count + c]) >
+                    std::fabs(output[channel_peak_index * channel_count + c]))
+                channel_peak_index = i;
+
+        if (c == 0)
+            peak_index = channel_peak_index;
+        else if (channel_peak_index != peak_index)
+            return 0;
+
+    }
+
+    return peak_index - impulse_index;
+
+}
+
+
+int main() {
+
+    const size_t max_input_size = 128;
+    const double window_duration = .02;
+
+    for (unsigned channel_count : { 1u, 2u })
+    for (size_t block_size : { 0u, 256u })
+    for (SongFinderQuality quality : {
+            SongFinderQuality::Standard, SongFinderQuality::Balanced,
+            SongFinderQuality::Economy })
+    for (unsigned cutoff : { 0u, 2500u })
+    for (unsigned pitch_shift_factor : { 2u, 3u, 4u }) {
+
+        auto make_processor = [&]() {
+            return SongFinderProcessor(
+                max_input_size, cutoff, pitch_shift_factor, "SongFinder",
+                window_duration, SongFinderKernels(), block_size, quality,
+                ActivityGateSettings(),
+                SongFinderProcessor::standard_sample_rate, channel_count);
+        };
+
+        SongFinderProcessor processor = make_processor();
+        const size_t w = processor.minimum_priming_size() + 1;
+        const size_t latency = processor.latency();
+
+        // Put each impulse in the third window, to be well clear of
+        // the start of the output, and leave room for the longest
+        // delay of any impulse in that window.
+        const size_t window_start = 2 * w + 1;
+        const size_t frame_count =
+            window_start + latency + pitch_shift_factor * w + w;
+
+        for (size_t offset : { size_t(0), w / 3, w - 1 }) {
+
+            SongFinderProcessor processor = make_processor();
+
+            const size_t delay = measure_delay(
+                processor, window_start + offset, frame_count,
+                max_input_size);
+
+            const size_t expected_delay =
+                latency + (pitch_shift_factor - 1) * offset;
+
+            check(
+                delay == expected_delay,
+                "impulse %zu samples into a window delayed %zu samples "
+                "rather than %zu: channels %u, block size %zu, "
+                "quality %d, cutoff %u, shift %u",
+                offset, delay, expected_delay, channel_count, block_size,
+                static_cast<int>(quality), cutoff, pitch_shift_factor);
+
+        }
+
+    }
+
+    return test_result("LatencyTest");
+
+}
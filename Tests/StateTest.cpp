@@ -0,0 +1,194 @@
+// Checks that a `SongFinderProcessor` into which a snapshot of another
+// processor's state is restored continues exactly where the other one
+// was.
+//
+// For each of a range of configurations, a reference processor
+// processes the whole input without interruption. Then, for each of
+// several points in the input, another processor processes the input
+// up to that point, and its state is restored into a third processor,
+// which has already processed unrelated input, so that anything the
+// snapshot leaves out shows. The third processor processes the rest of
+// the input, and its output must be exactly that of the reference.
+//
+// The input is loud noise, then noise quiet enough for the activity
+// gates to close, then silence long enough for the processors to skip
+// it, then loud noise again, with a snapshot point in each part. The
+// input ends with a block larger than the max input size, whose
+// `OversizeBlock` event must carry the same block number for both
+// processors.
+
+
+#include <random>
+#include <vector>
+#include "SongFinderProcessor.hpp"
+#include "TestSupport.hpp"
+
+
+using std::vector;
+
+
+static const double sample_rate = SongFinderProcessor::standard_sample_rate;
+static const size_t max_input_size = 256;
+static const size_t call_size = 100;
+static const size_t oversize_call_size = 300;
+
+
+// Returns `seconds` of input as a frame count that is a whole number of
+// calls.
+static size_t frames(double seconds) {
+    return static_cast<size_t>(seconds * sample_rate) / call_size * call_size;
+}
+
+
+static const size_t loud_size = frames(.25);
+static const size_t quiet_size = frames(.4);
+static const size_t silent_size = frames(.4);
+static const size_t frame_count =
+    loud_size + quiet_size + silent_size + loud_size + oversize_call_size;
+
+
+static vector<float> create_input(unsigned channel_count, std::mt19937 &random) {
+
+    std::uniform_real_distribution<float> samples(-1, 1);
+
+    vector<float> input(frame_count * channel_count);
+
+    const size_t quiet_start = loud_size;
+    const size_t silent_start = quiet_start + quiet_size;
+    const size_t loud_start = silent_start + silent_size;
+
+    for (size_t i = 0; i != frame_count; ++i) {
+        const float level =
+            i < quiet_start ? 1 :
+            i < silent_start ? 1e-6f :
+            i < loud_start ? 0 : 1;
+        for (unsigned c = 0; c != channel_count; ++c)
+            input[i * channel_count + c] = level * samples(random);
+    }
+
+    return input;
+
+}
+
+
+// Processes the interleaved frames of `input` from frame `start` to
+// frame `end`, a multiple of `call_size` or `frame_count`, in calls of
+// `call_size` frames, except that the last `oversize_call_size` frames
+// of the input are processed in one call, writing the output to the
+// same frames of `output`.
+static void process(
+    SongFinderProcessor &processor, const vector<float> &input,
+    vector<float> &output, unsigned channel_count, size_t start,
+    size_t end) {
+
+    for (size_t i = start; i != end; ) {
+
+        const size_t n = frame_count - i == oversize_call_size ?
+            oversize_call_size : call_size;
+
+        const float *inputs[2] = { };
+        float *outputs[2] = { };
+        for (unsigned c = 0; c != channel_count; ++c) {
+            inputs[c] = &input[i * channel_count + c];
+            outputs[c] = &output[i * channel_count + c];
+        }
+
+        processor.process(inputs, n, outputs, channel_count, channel_count);
+
+        i += n;
+
+    }
+
+}
+
+
+// Returns the block number of the first `OversizeBlock` event in
+// `diagnostics`, or -1 if there is none.
+static long oversize_block_num(DiagnosticsRing &diagnostics) {
+    long block_num = -1;
+    diagnostics.drain([&](const DiagnosticEvent &event) {
+        if (event.type == DiagnosticEventType::OversizeBlock && block_num == -1)
+            block_num = event.block_num;
+    });
+    return block_num;
+}
+
+
+int main() {
+
+    std::mt19937 random(48);
+
+    ActivityGateSettings gated;
+    gated.enabled = true;
+    gated.hold_duration = .1;
+
+    const size_t snapshot_frames[] = {
+        frames(.1), loud_size + frames(.3),
+        loud_size + quiet_size + frames(.3),
+        loud_size + quiet_size + silent_size + frames(.1)
+    };
+
+    for (unsigned channel_count : { 1u, 2u })
+    for (size_t block_size : { 0u, 64u })
+    for (unsigned cutoff : { 0u, 2000u })
+    for (bool gate_enabled : { false, true })
+    for (unsigned pitch_shift_factor : { 2u, 4u }) {
+
+        const vector<float> input = create_input(channel_count, random);
+        const vector<float> other_input = create_input(channel_count, random);
+
+        auto make_processor = [&]() {
+            return SongFinderProcessor(
+                max_input_size, cutoff, pitch_shift_factor, "SongFinder",
+                .02, SongFinderKernels(), block_size,
+                SongFinderQuality::Standard,
+                gate_enabled ? gated : ActivityGateSettings(), sample_rate,
+                channel_count);
+        };
+
+        DiagnosticsRing reference_diagnostics;
+        SongFinderProcessor reference = make_processor();
+        reference.set_diagnostics(&reference_diagnostics, 0);
+        vector<float> expected(input.size());
+        process(reference, input, expected, channel_count, 0, frame_count);
+        const long expected_block_num = oversize_block_num(reference_diagnostics);
+
+        vector<char> state(reference.state_size());
+
+        for (size_t snapshot_frame : snapshot_frames) {
+
+            SongFinderProcessor saved = make_processor();
+            vector<float> output(input.size());
+            process(saved, input, output, channel_count, 0, snapshot_frame);
+            saved.save_state(state.data());
+
+            DiagnosticsRing diagnostics;
+            SongFinderProcessor restored = make_processor();
+            restored.set_diagnostics(&diagnostics, 0);
+            vector<float> other_output(other_input.size());
+            process(
+                restored, other_input, other_output, channel_count, 0,
+                snapshot_frame / 2 / call_size * call_size);
+            diagnostics.drain([](const DiagnosticEvent &) { });
+
+            const bool restored_ok = restored.restore_state(state.data());
+
+            process(
+                restored, input, output, channel_count, snapshot_frame,
+                frame_count);
+
+            check(
+                restored_ok && output == expected &&
+                    oversize_block_num(diagnostics) == expected_block_num,
+                "restored processor did not continue where saved one was: "
+                "channels %u, block size %zu, cutoff %u, gate %d, shift %u, "
+                "snapshot at frame %zu", channel_count, block_size, cutoff,
+                gate_enabled, pitch_shift_factor, snapshot_frame);
+
+        }
+
+    }
+
+    return test_result("StateTest");
+
+}
@@ -0,0 +1,107 @@
+// Measures the render thread cost of the `SpectrumAnalyzer` tap.
+//
+// The tap is the only work the render thread does for the spectrum
+// display: it copies each block of one input channel and one output
+// channel into a ring, from which the analyzer's worker thread
+// computes spectra. The benchmark taps blocks at the pace of a
+// real-time host, sleeping for the rest of each block's period while
+// the worker runs, so that the caches are as cold as they would be on
+// the render thread. For each block size, and for channel data read
+// from separate and from interleaved buffers, it prints the mean,
+// 99th percentile, and largest time per block of the tap, the mean as
+// a percentage of the block period, and the number of tapped frames
+// that the tap dropped because the worker fell behind, which should be
+// zero. The largest time includes any preemption of the tapping thread
+// by the scheduler.
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "SpectrumAnalyzer.hpp"
+
+
+using std::vector;
+
+
+static const double sample_rate = 48000;
+static const double run_duration = 1;     // seconds per block size
+
+
+static void run(size_t block_size, size_t stride) {
+
+    SpectrumAnalyzer analyzer;
+    analyzer.set_enabled(true);
+
+    vector<float> input(block_size * stride), output(block_size * stride);
+    for (size_t i = 0; i != input.size(); ++i) {
+        input[i] = static_cast<float>(
+            .5 * std::sin(2 * M_PI * 3000 * i / sample_rate));
+        output[i] = .5f * input[i];
+    }
+
+    const size_t block_count =
+        static_cast<size_t>(run_duration * sample_rate) / block_size;
+    const std::chrono::duration<double> period(block_size / sample_rate);
+
+    vector<double> times;
+    times.reserve(block_count);
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    for (size_t n = 0; n != block_count; ++n) {
+
+        const auto tap_start_time = std::chrono::steady_clock::now();
+
+        if (analyzer.begin_tap(block_size)) {
+            analyzer.tap_input(input.data(), block_size, stride);
+            analyzer.tap_output(output.data(), block_size, stride);
+            analyzer.end_tap(block_size);
+        }
+
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - tap_start_time;
+        times.push_back(elapsed.count());
+
+        std::this_thread::sleep_until(
+            start_time + std::chrono::duration_cast<
+                std::chrono::steady_clock::duration>((n + 1) * period));
+
+    }
+
+    double mean_time = 0;
+    for (double time : times)
+        mean_time += time / block_count;
+    std::sort(times.begin(), times.end());
+
+    std::printf(
+        "%5zu %11s  %6.3f %6.3f %7.3f  %6.4f  %7llu\n", block_size,
+        stride == 1 ? "separate" : "interleaved", mean_time * 1e6,
+        times[block_count * 99 / 100] * 1e6, times.back() * 1e6,
+        100 * mean_time / period.count(),
+        (unsigned long long) analyzer.dropped_count());
+
+    analyzer.set_enabled(false);
+
+}
+
+
+int main() {
+
+    std::printf(
+        "Render thread time in us per block of tapping one input and one "
+        "output channel,\nand as a percentage of the block's real-time "
+        "period:\n");
+    std::printf(
+        "block    channels    mean    p99     max  period  dropped\n");
+
+    for (size_t block_size : { 64u, 128u, 512u })
+    for (size_t stride : { 1u, 2u })
+        run(block_size, stride);
+
+    return 0;
+
+}
@@ -0,0 +1,57 @@
+#ifndef TEST_SUPPORT
+#define TEST_SUPPORT
+
+
+#include <cstdarg>
+#include <cstdio>
+
+
+// Minimal support for the tests in this directory. Each test is a
+// plain program that reports each failed check and exits with status
+// one if any check failed, so that `make check` stops at it.
+
+
+inline int &test_failure_count() {
+    static int count = 0;
+    return count;
+}
+
+
+// Reports a failure, described by the printf-style `format`, if
+// `condition` is false. Returns `condition`.
+inline bool check(bool condition, const char *format, ...) {
+
+    if (!condition) {
+
+        ++test_failure_count();
+
+        std::va_list arguments;
+        va_start(arguments, format);
+        std::fputs("FAILED: ", stdout);
+        std::vprintf(format, arguments);
+        std::fputs("\n", stdout);
+        va_end(arguments);
+
+    }
+
+    return condition;
+
+}
+
+
+// Reports the result of a test program and returns its exit status.
+inline int test_result(const char *name) {
+
+    const int count = test_failure_count();
+
+    if (count == 0)
+        std::printf("%s: passed\n", name);
+    else
+        std::printf("%s: %d checks failed\n", name, count);
+
+    return count == 0 ? 0 : 1;
+
+}
+
+
+#endif
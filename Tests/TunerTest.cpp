@@ -0,0 +1,87 @@
+// Checks that `SongFinderTuner` remembers its winners, in memory and
+// in its profile, and, since the tests are built with the address
+// sanitizer, that tuning frees the stages and buffers it times.
+
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "SongFinderTuner.hpp"
+#include "TestSupport.hpp"
+
+
+using std::string;
+
+
+static const char *const profile_path = "build/TunerTest.profile";
+
+
+struct Configuration {
+    unsigned cutoff;
+    unsigned pitch_shift_factor;
+    SongFinderQuality quality;
+    unsigned channel_count;
+};
+
+
+static SongFinderKernels tune(
+    SongFinderTuner &tuner, const Configuration &c) {
+    return tuner.kernels(
+        c.cutoff, c.pitch_shift_factor, .02, 0, c.quality,
+        SongFinderProcessor::standard_sample_rate, c.channel_count);
+}
+
+
+static bool same(const SongFinderKernels &a, const SongFinderKernels &b) {
+    return a.fir == b.fir && a.interpolator == b.interpolator;
+}
+
+
+int main() {
+
+    std::remove(profile_path);
+
+    const std::vector<Configuration> configurations = {
+        { 0, 2, SongFinderQuality::Standard, 1 },
+        { 2000, 2, SongFinderQuality::Standard, 1 },
+        { 2000, 3, SongFinderQuality::Balanced, 2 },
+        { 4000, 4, SongFinderQuality::Economy, 2 }
+    };
+
+    SongFinderTuner tuner;
+    tuner.set_override("");
+    tuner.set_profile_path(profile_path);
+
+    std::vector<SongFinderKernels> winners;
+    for (const Configuration &c : configurations)
+        winners.push_back(tune(tuner, c));
+
+    // A processor with no highpass filter does not need a FIR kernel.
+    check(
+        winners[0].fir == FirKernel::Direct,
+        "tuner chose a FIR kernel for a processor with a zero cutoff");
+
+    // A tuner asked again returns its cached winners, and a new tuner
+    // with the same profile returns the winners from the profile,
+    // rather than measuring again and perhaps choosing differently.
+    SongFinderTuner profiled_tuner;
+    profiled_tuner.set_override("");
+    profiled_tuner.set_profile_path(profile_path);
+
+    for (size_t i = 0; i != configurations.size(); ++i) {
+
+        check(
+            same(tune(tuner, configurations[i]), winners[i]),
+            "tuner did not remember winners of configuration %zu", i);
+
+        check(
+            same(tune(profiled_tuner, configurations[i]), winners[i]),
+            "profile did not hold winners of configuration %zu", i);
+
+    }
+
+    std::remove(profile_path);
+
+    return test_result("TunerTest");
+
+}